@@ -0,0 +1,53 @@
+#ifndef APP_TASKS_H
+#define APP_TASKS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+#include "result_schema.h"
+
+struct StateMachineContext;
+
+// Task layout. With TASK_SPLIT the protocol task (UART RX, frames, state
+// machine, TX queue) runs on PROTO_TASK_CORE at PROTO_TASK_PRIORITY and
+// the output task (BLE notifications, result sinks, live samples) on
+// OUTPUT_TASK_CORE. The StateMachineContext belongs to the protocol task
+// alone; everything crossing between them goes through the bounded queues
+// below, so a slow BLE link never delays a poll. Without TASK_SPLIT both
+// halves run one after the other in loop(), as before.
+
+struct TaskStats
+{
+  uint32_t commandsDropped; // command queue full
+  uint32_t messagesDropped; // BLE message queue full
+  uint32_t resultsDropped;  // result queue full
+  uint8_t messagesHighWater;
+  uint32_t resultQueuedUs;  // last result: posted -> picked up by the output side
+  uint32_t resultDoneUs;    // last result: posted -> every sink has it (BLE: first piece out)
+  uint32_t resultDoneMaxUs;
+};
+
+// Start the layout (end of setup). The UART RX callback is bound to the
+// protocol task here.
+void appTasksBegin(StateMachineContext &ctx, HardwareSerial &bmh);
+
+// Body of loop(): the whole protocol + output pass without TASK_SPLIT,
+// a sleep with it
+void appTasksLoop();
+
+// Any task -> protocol task: user JSON (BLE write callback, Serial).
+// False (and counted) when the queue is full.
+bool postCommand(const String &json);
+
+// Protocol task -> output task: app JSON message, copied
+bool postBleJson(const String &json);
+// Protocol task -> output task: finished result for every sink
+bool postResult(const MeasurementResult &r, ResultFormat format);
+
+// Consistent copy (the counters are written from several tasks)
+TaskStats taskStats();
+// Queue counters. Result latency is logged by the output task as each
+// result is delivered ("Result latency: ...").
+void printTaskStats();
+
+#endif // APP_TASKS_H
@@ -0,0 +1,26 @@
+#ifndef AUTO_ZERO_H
+#define AUTO_ZERO_H
+
+#include <Arduino.h>
+#include "types.h"
+
+// Background zero tracking. While the scale is idle (WAIT_JSON,
+// WAIT_SCALE_EMPTY) every A1 reading close to the current zero nudges it
+// through a slow filter, so ADC drift is followed without a TARE_WEIGHT
+// phase. The zero is in the same units as MeasurementData::tare_offset
+// (raw ADC) and the last good value is kept in NVS across reboots.
+
+// Load the persisted zero (call once at boot)
+void autoZeroBegin();
+
+// Feed an A1 reading taken while nobody should be on the scale
+void autoZeroSample(uint32_t adcRaw, const CalibData &calib);
+
+// Seed the tracker from a full tare (TARE_WEIGHT result)
+void autoZeroSet(long offset);
+
+// True when the tracked zero was confirmed recently enough to skip the tare
+bool autoZeroFresh();
+long autoZeroOffset();
+
+#endif // AUTO_ZERO_H
@@ -12,10 +12,24 @@
 #define SERVICE_UUID        "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
 #define CHARACTERISTIC_UUID_RX "beb5483e-36e1-4688-b7f5-ea07361b26a8"
 #define CHARACTERISTIC_UUID_TX "beb5483f-36e1-4688-b7f5-ea07361b26a8"
+#define CHARACTERISTIC_UUID_LIVE "beb54840-36e1-4688-b7f5-ea07361b26a8"
 
 // BLE Device Name
 #define BLE_DEVICE_NAME "Thaisook_BCA"
 
+// Notifications
+#define BLE_NOTIFY_MAX 512     // largest notification payload (MTU 515 requested)
+#define BLE_NOTIFY_MIN 20      // payload of the default 23 byte MTU
+#define BLE_NOTIFY_GAP_MS 20   // min spacing between notifications
+#define BLE_TX_STREAM_MAX 4096 // largest message on TX (the compact result JSON is ~3 KB)
+
+// Live (realtime weight) characteristic
+#define LIVE_RATE_MIN_HZ 1
+#define LIVE_RATE_MAX_HZ 25
+#define LIVE_RATE_DEFAULT_HZ 10    // until the app writes its own rate
+#define LIVE_DEADBAND_DEFAULT 1    // 10 g units
+#define LIVE_HEARTBEAT_MS 1000     // resend an unchanged sample this often
+
 // Callback function type for received data
 typedef void (*BLEDataCallback)(const String &data);
 
@@ -23,7 +37,34 @@ class BLEHandler {
 public:
     BLEHandler();
     void begin(BLEDataCallback callback);
-    void sendData(const String &data);
+    // TX messages are streamed without blocking: the bytes go into the
+    // stream buffer and serviceTx() notifies one notification-sized piece
+    // per BLE_NOTIFY_GAP_MS. One message at a time, from the output side.
+    bool sendData(const String &data);
+    // Copy and start streaming; false when not connected, busy or too long
+    bool sendBytes(const uint8_t *data, size_t len);
+    // Encode a message in place: write up to `cap` bytes at the returned
+    // buffer, then txCommit(len). nullptr when not connected or busy.
+    char *txBuffer(size_t &cap);
+    void txCommit(size_t len);
+    // Send the next piece if the gap has passed; true while bytes are left
+    bool serviceTx();
+    bool txBusy() const { return txLen > 0; }
+    // ms until serviceTx() can send the next piece (0 = now)
+    uint32_t txDueInMs();
+    // Send one notification (len <= notifyPayloadSize()) if BLE_NOTIFY_GAP_MS
+    // has passed since the last one; false (nothing sent) otherwise
+    bool sendChunk(const uint8_t *data, size_t len);
+    // Usable payload per notification for the connected peer (MTU - 3)
+    size_t notifyPayloadSize();
+    // Realtime sample on the live characteristic: one notification,
+    // never blocks (false when not subscribed or too soon after the last
+    // live one)
+    bool notifyLive(const uint8_t *data, size_t len);
+    bool liveSubscribed();
+    // Live settings written by the app (0 Hz = app never configured it)
+    uint8_t liveRateHz() const { return liveRate; }
+    uint8_t liveDeadband() const { return liveDeadbandUnits; }
     bool isConnected();
     String getDeviceName();
     
@@ -31,9 +72,20 @@ private:
     BLEServer *bleServer;
     BLECharacteristic *txCharacteristic;
     BLECharacteristic *rxCharacteristic;
+    BLECharacteristic *liveCharacteristic;
+    BLE2902 *liveCccd;
+    volatile uint8_t liveRate;
+    volatile uint8_t liveDeadbandUnits;
     BLEDataCallback dataCallback;
     bool deviceConnected;
     bool oldDeviceConnected;
+    // One per characteristic, each written only by its own sender, so the
+    // result chunker and the live sampler never race on a shared stamp
+    unsigned long lastNotifyMs;     // TX, sendChunk()
+    unsigned long lastLiveNotifyMs; // LIVE, notifyLive()
+    uint8_t txStream[BLE_TX_STREAM_MAX];
+    size_t txLen;  // bytes in the stream, 0 = idle
+    size_t txSent; // bytes already notified
     Preferences preferences;
     
     void setupBLE();
@@ -42,6 +94,7 @@ private:
     
     friend class ServerCallbacks;
     friend class CharacteristicCallbacks;
+    friend class LiveCallbacks;
 };
 
 // Global instance
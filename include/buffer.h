@@ -2,15 +2,183 @@
 #define BUFFER_H
 
 #include <Arduino.h>
+#include <atomic>
 #include "config.h"
 
-// Circular buffer management
-void pushRxByte(uint8_t b);
+// Non-owning view of a frame that still lives inside the RX ring.
+// A frame that wraps the end of the ring is split into two spans
+// (len2 == 0 when the frame is contiguous).
+struct FrameView
+{
+  const uint8_t *data1 = nullptr;
+  size_t len1 = 0;
+  const uint8_t *data2 = nullptr;
+  size_t len2 = 0;
+
+  size_t size() const { return len1 + len2; }
+  uint8_t operator[](size_t i) const { return i < len1 ? data1[i] : data2[i - len1]; }
+
+  // Little-endian field access at byte offset i (handles the wrap point)
+  uint16_t u16(size_t i) const;
+  int16_t i16(size_t i) const;
+  uint32_t u32(size_t i) const;
+
+  // Copy the whole frame into a contiguous buffer (at most two memcpy)
+  void copyTo(uint8_t *dst) const;
+};
+
+// What to do when a received chunk does not fit in the RX ring.
+// The producer never moves tail, so the bytes that did not fit are always
+// lost; the policy decides what the consumer does with the bytes around the gap.
+enum RxOverflowPolicy : uint8_t
+{
+  RX_OVERFLOW_DROP_NEWEST, // keep the queued bytes, let the checksum reject the cut frame
+  RX_OVERFLOW_DROP_OLDEST, // flush the backlog queued before the gap, decode only fresh bytes
+  RX_OVERFLOW_RESYNC       // drop only the frame cut by the gap and hunt the next header after it
+};
+
+// Overflow counters (cumulative since boot)
+struct RxOverflowStats
+{
+  uint32_t events; // chunks that did not fit
+  uint32_t bytes;  // bytes dropped by the producer
+};
+
+// Free space of the ring as up to two spans (producer side)
+struct RxWriteSpans
+{
+  uint8_t *data1;
+  size_t len1;
+  uint8_t *data2;
+  size_t len2;
+
+  size_t size() const { return len1 + len2; }
+};
+
+// Circular RX buffer with power-of-two capacity.
+// head/tail are free-running counters, indices are taken with a mask.
+// Lock-free single producer / single consumer: only the UART RX callback
+// calls the producer side, only the protocol loop calls peek/view/discard/clear.
+class RxRing
+{
+public:
+  static const size_t CAPACITY = RX_BUF_SIZE;
+  static const size_t MASK = RX_BUF_SIZE - 1;
+
+  // Producer side: fill writable() spans, then publish with commit()
+  void writable(RxWriteSpans &out);
+  void commit(size_t n) { head.store(head.load(std::memory_order_relaxed) + n, std::memory_order_release); }
+  // Record that `dropped` bytes were lost at the current write position
+  void noteOverflow(size_t dropped);
+
+  // Consumer side: fetch the write position of the last overflow, if any
+  bool takeOverflow(size_t &gapAt);
+  RxOverflowStats overflowStats() const;
+
+  size_t available() const
+  {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+  size_t readCount() const { return tail.load(std::memory_order_relaxed); }
+  uint8_t peek(size_t i) const { return buf[(readCount() + i) & MASK]; }
+  void discard(size_t n);
+  void clear() { tail.store(head.load(std::memory_order_acquire), std::memory_order_release); }
+
+  // Build a view of len bytes starting at offset i from the read position
+  void view(size_t i, size_t len, FrameView &out) const;
+
+private:
+  uint8_t buf[RX_BUF_SIZE];
+  std::atomic<size_t> head{0}; // total bytes written (producer)
+  std::atomic<size_t> tail{0}; // total bytes consumed (consumer)
+  std::atomic<size_t> gapAt{0};
+  std::atomic<bool> gapPending{false};
+  std::atomic<uint32_t> overflowEvents{0};
+  std::atomic<uint32_t> overflowBytes{0};
+};
+
+static_assert((RX_BUF_SIZE & (RX_BUF_SIZE - 1)) == 0, "RX_BUF_SIZE must be a power of two");
+static_assert(RX_BUF_SIZE >= 256, "RX_BUF_SIZE must hold the largest (255 byte) frame");
+
+// Frame decoder statistics for the current session
+struct FrameStats
+{
+  uint32_t framesOk = 0;
+  uint32_t checksumErrors = 0;
+  uint32_t lengthErrors = 0;
+  uint32_t overflowErrors = 0; // frames cut by an RX overflow (RESYNC policy)
+  uint32_t bytesDropped = 0;   // garbage between frames + resync bytes
+
+  uint32_t framesLost() const { return checksumErrors + lengthErrors + overflowErrors; }
+};
+
+// Incremental frame decoder. Keeps its position across calls so every byte
+// that arrives is examined once; a bad length or checksum drops only the
+// header byte and hunts again from header+1.
+class FrameDecoder
+{
+public:
+  enum Phase : uint8_t
+  {
+    HUNT,  // looking for 0xAA
+    LEN,   // header seen, waiting for length byte
+    BODY,  // accumulating order + data bytes
+    CHECK  // waiting for checksum byte
+  };
+
+  static const uint8_t HEADER = 0xAA;
+  static const uint8_t MIN_FRAME_LEN = 5;
+
+  bool next(RxRing &ring, FrameView &frame);
+  void release(RxRing &ring, const FrameView &frame);
+  void reset();
+
+  Phase phase() const { return state; }
+  // Buffered bytes needed before another frame can complete (read by the
+  // RX producer to decide whether to wake the consumer)
+  size_t bytesWanted() const { return wanted.load(std::memory_order_relaxed); }
+  const FrameStats &stats() const { return counters; }
+  void resetStats() { counters = FrameStats(); }
+  void setOverflowPolicy(RxOverflowPolicy p) { policy = p; }
+
+private:
+  void resync(RxRing &ring);
+  void publishWanted();
+  void applyOverflow(RxRing &ring, size_t gap);
+  bool cutByGap() const;
+  void skipToGap(RxRing &ring);
+
+  Phase state = HUNT;
+  size_t pos = 0;      // bytes of the candidate frame already examined
+  size_t base = 0;     // ring read count the candidate starts at
+  uint8_t frameLen = 0;
+  uint8_t sum = 0;
+  FrameStats counters;
+  RxOverflowPolicy policy = RX_OVERFLOW_POLICY;
+  bool gapPending = false;
+  size_t gapAt = 0; // ring write count where bytes went missing
+  std::atomic<size_t> wanted{MIN_FRAME_LEN};
+};
+
+extern RxRing rxRing;
+extern FrameDecoder frameDecoder;
+
+// Bulk ingest (producer side): at most two copies into the ring, overflow
+// handled once per chunk. Returns the number of bytes stored.
+size_t pushRxBytes(const uint8_t *data, size_t len);
+size_t pushRxBytes(Stream &port, size_t len);
 size_t rxAvailable();
-bool rxPeek(size_t i, uint8_t &out);
-bool rxRead(uint8_t &out);
 
-// Frame parsing
-bool tryParseFrame(uint8_t *frameBuf, size_t &frameLen);
+void setRxOverflowPolicy(RxOverflowPolicy policy);
+RxOverflowStats rxOverflowStats();
+
+// Frame parsing: on success `frame` points into the ring and stays valid
+// until releaseFrame() is called.
+bool tryParseFrame(FrameView &frame);
+void releaseFrame(const FrameView &frame);
+
+// Per-session decoder statistics
+const FrameStats &frameStats();
+void resetFrameStats();
 
 #endif // BUFFER_H
@@ -6,4 +6,28 @@
 // Load calibration data from EEPROM
 void loadCalibration(CalibData &calib);
 
+// Convert scale_factor/offset to the fixed-point form used per sample
+void prepareCalibration(CalibData &calib);
+
+// ADC counts (tare already removed) to grams, rounded to nearest
+inline int32_t adcToGrams(const CalibData &calib, int32_t counts)
+{
+  int64_t v = (int64_t)counts * calib.slope_q - calib.offset_q;
+  int64_t half = calib.slope_shift ? (int64_t)1 << (calib.slope_shift - 1) : 0;
+  return (int32_t)((v + half) >> calib.slope_shift);
+}
+
+// Difference between two readings in grams (offset cancels out)
+inline int32_t adcSpanToGrams(const CalibData &calib, int32_t counts)
+{
+  int64_t half = calib.slope_shift ? (int64_t)1 << (calib.slope_shift - 1) : 0;
+  return (int32_t)(((int64_t)counts * calib.slope_q + half) >> calib.slope_shift);
+}
+
+// 0.1 kg units used by the BMH protocol (D0 weight field)
+inline int32_t gramsToDeciKg(int32_t grams)
+{
+  return (grams >= 0) ? (grams + 50) / 100 : (grams - 50) / 100;
+}
+
 #endif // CALIBRATION_H
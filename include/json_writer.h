@@ -0,0 +1,56 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <Arduino.h>
+
+// Streaming JSON writer without heap use. Output goes either into a fixed
+// caller buffer, or through a small staging buffer to a sink callback.
+// Numbers are written from integers (fixed-point), no float/String involved.
+class JsonWriter
+{
+public:
+  typedef void (*Sink)(void *ctx, const char *data, size_t len);
+
+  static const uint8_t MAX_DEPTH = 6;
+
+  // Buffer mode: output is NUL-terminated, anything past cap is cut and
+  // overflowed() turns true. JsonWriter(nullptr, 0) only counts bytes.
+  JsonWriter(char *buf, size_t cap, bool compact = false);
+  // Sink mode: buf is staging, handed to sink each time it fills up
+  JsonWriter(char *buf, size_t cap, Sink sink, void *ctx, bool compact = false);
+
+  void beginObject(const char *key = nullptr);
+  void endObject();
+  void addString(const char *key, const char *value);
+  void addInt(const char *key, int32_t value);
+  // raw / 10^decimals, e.g. addFixed("weight_kg", 654, 1) -> 65.4
+  void addFixed(const char *key, int32_t raw, uint8_t decimals);
+  // "0x%02X" as a string
+  void addHex(const char *key, uint8_t value);
+
+  // Flush pending output; returns total bytes produced
+  size_t finish();
+
+  size_t size() const { return total; }
+  bool overflowed() const { return !sink && total > used; }
+
+private:
+  void member(const char *key);
+  void put(char c);
+  void put(const char *s);
+  void putFixed(int32_t raw, uint8_t decimals);
+  void flush();
+
+  char *buf;
+  size_t cap;
+  size_t pos = 0;   // bytes in buf (sink mode: staged, not yet flushed)
+  size_t used = 0;  // bytes stored in buf (buffer mode)
+  size_t total = 0; // bytes produced
+  Sink sink = nullptr;
+  void *ctx = nullptr;
+  bool compact;
+  uint8_t depth = 0;
+  bool first[MAX_DEPTH + 1];
+};
+
+#endif // JSON_WRITER_H
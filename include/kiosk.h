@@ -0,0 +1,49 @@
+#ifndef KIOSK_H
+#define KIOSK_H
+
+#include <Arduino.h>
+#include "types.h"
+
+// Kiosk mode. The app queues the next profiles ahead ({"queue":[...]}).
+// While profiles are waiting the idle A1 poll runs every KIOSK_POLL_MS,
+// the next person stepping on (EV_STEP_ON, needs a fresh auto-zero)
+// starts the next session from the queue without the app, and DONE only
+// holds KIOSK_DONE_HOLD_MS. A run lasts from the first queued session to
+// the one that empties the queue.
+
+struct KioskStats
+{
+  uint32_t sessions;     // completed queued sessions in this run
+  uint32_t aborted;
+  uint32_t firstStartMs; // run start
+  uint32_t lastDoneMs;   // last result of the run
+  uint32_t deadCount;    // dead time: previous result -> next session start
+  uint32_t deadSumMs;
+  uint32_t deadMaxMs;
+
+  // sessions per hour x100 over the run so far
+  uint32_t centiPerHour() const
+  {
+    uint32_t ms = lastDoneMs - firstStartMs;
+    return (sessions && ms) ? (uint32_t)((uint64_t)sessions * 360000000ULL / ms) : 0;
+  }
+  uint32_t deadAvgMs() const { return deadCount ? deadSumMs / deadCount : 0; }
+};
+
+// False when the queue is full
+bool kioskEnqueue(const UserInfo &user);
+void kioskClear();
+uint8_t kioskPending();
+// A run is going (profiles queued, or its last session still measuring)
+bool kioskActive();
+
+// Next queued profile for a session starting now. False when empty.
+bool kioskTake(UserInfo &user);
+// The queued session in progress ended; no-op when none is running
+void kioskSessionEnd(bool completed);
+
+const KioskStats &kioskStats();
+// Log the run and send {"type":"kiosk",...} to the app
+void kioskReport();
+
+#endif // KIOSK_H
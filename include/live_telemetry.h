@@ -0,0 +1,32 @@
+#ifndef LIVE_TELEMETRY_H
+#define LIVE_TELEMETRY_H
+
+#include <Arduino.h>
+#include "types.h"
+
+// Packed realtime sample on the live characteristic (little-endian)
+//   0  u32  timestamp, ms since boot
+//   4  i16  weight, 10 g units
+//   6  u8   stability progress (stable_count, 0..STABLE_REQUIRED_CNT)
+//   7  u8   state (State enum)
+const size_t LIVE_SAMPLE_SIZE = 8;
+
+struct LiveStats
+{
+  uint32_t offered;   // readings handed to liveOffer()
+  uint32_t sent;      // notifications sent
+  uint32_t coalesced; // readings dropped by the rate limit or the deadband
+};
+
+// Offer the newest reading. It goes out at the app's rate; readings that
+// stay inside the deadband (same progress and state) are not resent.
+// Protocol side; only stores the reading.
+void liveOffer(int32_t weightG, int progress, State state);
+// Send the pending reading when its slot opens (output side, every pass)
+void liveService();
+// The app listens on the live characteristic (per-sample JSON is skipped)
+bool liveActive();
+const LiveStats &liveStats();
+void resetLiveStats();
+
+#endif // LIVE_TELEMETRY_H
@@ -0,0 +1,164 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include <type_traits>
+#include "config.h"
+
+// Deferred logging. LOG_ERROR..LOG_TRACE above LOG_LEVEL (config.h) expand
+// to nothing, arguments included. Enabled records are packed as binary
+// (format pointer + raw argument words) into a RAM ring and formatted by a
+// low-priority task, so the caller never waits for the console.
+//
+// Formats are printf-style. The format string must be a literal (only its
+// pointer is stored); %s arguments are copied, up to LOG_STR_MAX bytes.
+// A record is one line: a trailing newline is added when missing.
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+#define LOG_LEVEL_TRACE 5
+
+const uint8_t LOG_MAX_WORDS = 24; // argument words per record
+const uint8_t LOG_STR_MAX = 48;   // bytes kept of each %s argument
+
+struct LogStats
+{
+  uint32_t written;
+  uint32_t dropped;    // ring full, record lost
+  uint16_t highWater;  // most bytes queued at once
+};
+
+// Start the drain task (first thing in setup)
+void logBegin();
+// Wait (bounded) until the drain task has printed everything queued, for
+// code that is about to print straight to Serial
+void logFlush();
+LogStats logStats();
+// Raw text (no format, no added newline) for output that has to arrive
+// whole, like the result JSON: waits up to LOG_FLUSH_TIMEOUT_MS for ring
+// space instead of dropping. Printed regardless of LOG_LEVEL.
+bool logText(const char *data, size_t len);
+
+// Used by the macros below
+bool logWrite(uint8_t level, const char *fmt, const uint32_t *words, uint8_t count);
+bool logWriteHex(uint8_t level, const char *prefix, const uint8_t *data1, size_t len1,
+                 const uint8_t *data2 = nullptr, size_t len2 = 0);
+
+namespace logpack
+{
+struct Args
+{
+  uint32_t w[LOG_MAX_WORDS];
+  uint8_t n = 0;
+
+  void put(uint32_t v)
+  {
+    if (n < LOG_MAX_WORDS)
+      w[n++] = v;
+  }
+};
+
+template <typename T>
+inline typename std::enable_if<(std::is_integral<T>::value || std::is_enum<T>::value) && sizeof(T) <= 4>::type
+add(Args &a, T v)
+{
+  a.put((uint32_t)v);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && sizeof(T) == 8>::type
+add(Args &a, T v)
+{
+  a.put((uint32_t)(uint64_t)v);
+  a.put((uint32_t)((uint64_t)v >> 32));
+}
+
+// %f & co: kept as float, widened back to double when formatted
+inline void add(Args &a, double v)
+{
+  float f = (float)v;
+  uint32_t u;
+  memcpy(&u, &f, sizeof(u));
+  a.put(u);
+}
+
+// %s: length word + bytes, so the caller's buffer may go away
+inline void add(Args &a, const char *s)
+{
+  size_t len = 0;
+  while (s && len < LOG_STR_MAX && s[len])
+    len++;
+  a.put((uint32_t)len);
+  for (size_t i = 0; i < len; i += 4)
+  {
+    uint32_t u = 0;
+    memcpy(&u, s + i, (len - i < 4) ? len - i : 4);
+    a.put(u);
+  }
+}
+
+inline void add(Args &a, char *s) { add(a, (const char *)s); }
+inline void add(Args &a, const void *p) { a.put((uint32_t)(uintptr_t)p); }
+
+inline void addAll(Args &) {}
+
+template <typename T, typename... R>
+inline void addAll(Args &a, T v, R... rest)
+{
+  add(a, v);
+  addAll(a, rest...);
+}
+} // namespace logpack
+
+template <typename... A>
+inline void logRecord(uint8_t level, const char *fmt, A... args)
+{
+  logpack::Args a;
+  logpack::addAll(a, args...);
+  logWrite(level, fmt, a.w, a.n);
+}
+
+#define LOG_NOTHING() \
+  do                  \
+  {                   \
+  } while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logRecord(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) LOG_NOTHING()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) logRecord(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) LOG_NOTHING()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logRecord(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_NOTHING()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logRecord(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOG_NOTHING()
+#endif
+
+// Hex dumps of protocol frames ("prefix AA 05 ...")
+#if LOG_LEVEL >= LOG_LEVEL_TRACE
+#define LOG_TRACE(...) logRecord(LOG_LEVEL_TRACE, __VA_ARGS__)
+#define LOG_TRACE_HEX(prefix, data, len) logWriteHex(LOG_LEVEL_TRACE, prefix, data, len)
+#define LOG_TRACE_FRAME(prefix, frame) \
+  logWriteHex(LOG_LEVEL_TRACE, prefix, (frame).data1, (frame).len1, (frame).data2, (frame).len2)
+#else
+#define LOG_TRACE(...) LOG_NOTHING()
+#define LOG_TRACE_HEX(prefix, data, len) LOG_NOTHING()
+#define LOG_TRACE_FRAME(prefix, frame) LOG_NOTHING()
+#endif
+
+#endif // LOG_H
@@ -2,13 +2,16 @@
 #define MEASUREMENT_H
 
 #include "types.h"
+#include "buffer.h"
+#include "stability.h"
 #include <Arduino.h>
 
 // Global measurement variables
 struct MeasurementData {
   // Weight
-  long weight_final;
+  long weight_final;         // g
   bool weight_final_valid;
+  uint8_t weight_confidence; // 0..100, from the stability detector at lock
   
   // Tare
   long tare_offset;
@@ -20,21 +23,11 @@ struct MeasurementData {
   // Impedance
   ImpedanceData imp_20k;
   ImpedanceData imp_100k;
-  uint32_t imp_right_hand;
-  uint32_t imp_left_hand;
-  uint32_t imp_trunk;
-  uint32_t imp_right_foot;
-  uint32_t imp_left_foot;
+  ImpedanceData imp_final; // locked reading of the current B1 round
   bool impedance_final_valid;
   
-  // Stability tracking
-  long lastWeightValue;
-  int weightStableCount;
-  bool weightHasInitial;
-  
-  uint32_t lastImpRH, lastImpLH, lastImpT, lastImpRF, lastImpLF;
-  int impStableCount;
-  bool impHasInitial;
+  // Stability tracking (see stability.h)
+  ImpedanceStability impStability;
   
   // Result packets from device
   ResultPackets resultPackets;
@@ -46,18 +39,15 @@ void initMeasurementData(MeasurementData &data);
 // Reset measurement data for new cycle
 void resetMeasurementData(MeasurementData &data);
 
-// Process incoming frame
-void processDeviceFrame(const uint8_t *frame, size_t frameLen, 
-                        MeasurementData &mData, CalibData &calib, 
-                        UserInfo &userInfo, State &state);
-
-// Build and send final packet
-void buildAndSendFinalPacket(const UserInfo &userInfo, const MeasurementData &mData);
-
-// Parse and display result packets as JSON
-void parseAndDisplayResultJSON(const ResultPackets &packets, const MeasurementData &mData);
+// Process incoming frame (view into the RX ring, not copied). Returns the
+// state machine event it completes, EV_NONE if any; the state is changed
+// only by the state machine's dispatcher.
+FsmEvent processDeviceFrame(const FrameView &frame,
+                            MeasurementData &mData, CalibData &calib,
+                            State state);
 
-// Generate JSON string from result packets (for BLE transmission)
-String generateResultJSON(const ResultPackets &packets, const MeasurementData &mData);
+// Build and send final packet. False (nothing sent) when the user info or
+// the locked weight is missing.
+bool buildAndSendFinalPacket(const UserInfo &userInfo, const MeasurementData &mData);
 
 #endif // MEASUREMENT_H
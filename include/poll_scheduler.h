@@ -0,0 +1,35 @@
+#ifndef POLL_SCHEDULER_H
+#define POLL_SCHEDULER_H
+
+#include "types.h"
+#include "transaction.h"
+
+// Effective sample rate of one polling phase (one state)
+struct PollPhaseStats
+{
+  State state;
+  uint32_t startMs;
+  uint32_t samples;  // answered polls
+  uint32_t timeouts; // polls re-issued after the learned timeout
+  // Jitter: how late each poll went out after the earliest moment it could
+  // (answer + POLL_MIN_GAP_MS), i.e. what the loop / task layout adds
+  uint32_t lateCount;
+  uint64_t lateSumUs;
+  uint32_t lateMaxUs;
+};
+
+// Follow the state machine: closes (and reports) the current phase when
+// the state changes. Call once per loop before processing the state.
+void pollTrackState(State state);
+
+// Issue the next A1/B1 as soon as the previous one was answered (and
+// POLL_MIN_GAP_MS has passed), or after the learned timeout with back-off.
+// Returns true when a poll was sent.
+bool pollService(TxnCommand cmd);
+
+// Learned module turnaround for a poll command (EWMA, microseconds)
+uint32_t pollTurnaroundUs(TxnCommand cmd);
+
+const PollPhaseStats &pollPhaseStats();
+
+#endif // POLL_SCHEDULER_H
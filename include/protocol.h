@@ -2,15 +2,84 @@
 #define PROTOCOL_H
 
 #include <Arduino.h>
+#include "tx_queue.h"
+
+// Header byte of command frames sent to the device
+const uint8_t TX_FRAME_HEADER = 0x55;
 
 // Compute checksum for protocol
 uint8_t computeChecksum(const uint8_t *buf, size_t lenWithoutChecksum);
 
-// Send raw bytes
-void sendRaw(const uint8_t *data, size_t len);
+// Send raw bytes (copied into the TX queue). onWritten runs when the
+// frame reaches the UART (tx_queue.h).
+void sendRaw(const uint8_t *data, size_t len, TxWrittenFn onWritten = nullptr, void *arg = nullptr);
+// Send a frame in static storage, queued by pointer without a copy
+void sendConst(const uint8_t *data, size_t len, TxWrittenFn onWritten = nullptr, void *arg = nullptr);
+
+// Constant command frame built at compile time: the checksum is appended
+// by the compiler and the whole frame lives in flash.
+// Body = header, length, order, data...
+template <uint8_t... Body>
+struct CmdFrame
+{
+  static constexpr size_t size = sizeof...(Body) + 1;
+  static constexpr uint8_t bytes[size] = {Body..., (uint8_t)(0 - (Body + ...))};
+
+  static_assert(sizeof...(Body) >= 4, "command frame needs header, length, order and data");
+  static_assert(bytes[0] == TX_FRAME_HEADER, "command frames start with 0x55");
+  static_assert(bytes[1] == size, "length byte must equal the total frame length");
+};
+
+// Frame with runtime payload, same layout as CmdFrame.
+// Fill the payload from byte 3 on, then seal() appends the checksum.
+template <uint8_t Len>
+struct TxFrame
+{
+  static_assert(Len >= 5, "frame needs header, length, order, data and checksum");
+  static constexpr size_t size = Len;
+  uint8_t bytes[Len] = {};
+
+  explicit TxFrame(uint8_t order)
+  {
+    bytes[0] = TX_FRAME_HEADER;
+    bytes[1] = Len;
+    bytes[2] = order;
+  }
+
+  uint8_t &operator[](size_t i) { return bytes[i]; }
+
+  void putU16(size_t i, uint16_t v)
+  {
+    bytes[i] = (uint8_t)(v & 0xFF);
+    bytes[i + 1] = (uint8_t)((v >> 8) & 0xFF);
+  }
 
-// Build and send command with checksum
-void buildAndSend(const uint8_t *body, size_t bodyLen);
+  void seal() { bytes[Len - 1] = computeChecksum(bytes, Len - 1); }
+};
+
+// Prebuilt poll/mode commands
+using CmdA0 = CmdFrame<TX_FRAME_HEADER, 0x05, 0xA0, 0x01>;
+using CmdA1 = CmdFrame<TX_FRAME_HEADER, 0x05, 0xA1, 0x00>;
+using CmdB0_0303 = CmdFrame<TX_FRAME_HEADER, 0x06, 0xB0, 0x01, 0x03>;
+using CmdB0_0106 = CmdFrame<TX_FRAME_HEADER, 0x06, 0xB0, 0x01, 0x06>;
+using CmdB1 = CmdFrame<TX_FRAME_HEADER, 0x05, 0xB1, 0x01>;
+
+// D0 (8-electrode user data + impedances) frame length
+const uint8_t D0_FRAME_LEN = 0x1E;
+using D0Frame = TxFrame<D0_FRAME_LEN>;
+
+// Send a prebuilt or sealed frame with a single write
+template <class Frame>
+void sendFrame(const Frame &frame)
+{
+  sendRaw(frame.bytes, Frame::size);
+}
+
+template <class Cmd>
+void sendCmd()
+{
+  sendConst(Cmd::bytes, Cmd::size);
+}
 
 // Protocol commands
 void send_cmd_A0();
@@ -20,8 +89,19 @@ void send_cmd_B0_len6_0106();
 void send_cmd_B1();
 
 // Little-endian parsers
-uint16_t le_u16(const uint8_t *buf);
-int16_t le_i16(const uint8_t *buf);
-uint32_t le_u32(const uint8_t *buf);
+inline uint16_t le_u16(const uint8_t *buf)
+{
+  return (uint16_t)buf[0] | ((uint16_t)buf[1] << 8);
+}
+
+inline int16_t le_i16(const uint8_t *buf)
+{
+  return (int16_t)(buf[0] | (buf[1] << 8));
+}
+
+inline uint32_t le_u32(const uint8_t *buf)
+{
+  return (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
 
 #endif // PROTOCOL_H
@@ -0,0 +1,131 @@
+#ifndef RESULT_SCHEMA_H
+#define RESULT_SCHEMA_H
+
+#include <Arduino.h>
+#include "types.h"
+
+// Bump whenever a table below changes the binary layout
+const uint8_t RESULT_SCHEMA_VERSION = 1;
+
+// Five body segments, in packet order
+struct SegmentResult
+{
+  int32_t right_hand, left_hand, trunk, right_foot, left_foot;
+};
+
+// Decoded result values. Numbers are kept as the device sends them
+// (fixed-point, scaled by 10^decimals of their schema field).
+struct BodyCompositionResult
+{
+  uint8_t decodedMask; // bit i set when packet 0x51+i was decoded
+
+  // 0x51 body composition (0.1 kg)
+  int32_t weight, weight_std_min, weight_std_max;
+  int32_t moisture, moisture_std_min, moisture_std_max;
+  int32_t body_fat_mass, body_fat_std_min, body_fat_std_max;
+  int32_t protein_mass, protein_std_min, protein_std_max;
+  int32_t inorganic_salt, inorganic_std_min, inorganic_std_max;
+  int32_t lean_body_weight, lean_body_std_min, lean_body_std_max;
+  int32_t muscle_mass, muscle_std_min, muscle_std_max;
+  int32_t bone_mass, bone_std_min, bone_std_max;
+  int32_t skeletal_muscle, skeletal_std_min, skeletal_std_max;
+  int32_t ic_water, ic_water_std_min, ic_water_std_max;
+  int32_t ec_water, ec_water_std_min, ec_water_std_max;
+  int32_t body_cell_mass, bcm_std_min, bcm_std_max;
+  int32_t subcutaneous_fat_mass;
+
+  // 0x52 segmental analysis (0.1 kg / 0.1 %)
+  SegmentResult seg_fat_mass, seg_fat_percent, seg_muscle_mass, seg_muscle_ratio;
+
+  // 0x53 health metrics
+  int32_t body_score, physical_age, body_type, smi;
+  int32_t whr, whr_std_min, whr_std_max;
+  int32_t visceral_fat, vf_std_min, vf_std_max;
+  int32_t obesity_percent, obesity_std_min, obesity_std_max;
+  int32_t bmi, bmi_std_min, bmi_std_max;
+  int32_t body_fat_percent, body_fat_percent_std_min, body_fat_percent_std_max;
+  int32_t bmr, bmr_std_min, bmr_std_max;
+  int32_t recommended_intake, ideal_weight, target_weight;
+  int32_t weight_control, muscle_control, fat_control;
+  int32_t subq_fat_percent, subq_std_min, subq_std_max;
+
+  // 0x54 energy consumption (kcal per 30 min)
+  int32_t walk, golf, croquet, tennis_cycling_basketball, squash_tkd_fencing;
+  int32_t mountain_climbing, swimming_aerobic_jog, badminton_table_tennis;
+
+  // 0x55 segmental standards (0 low, 1 normal, 2 high)
+  SegmentResult fat_standard, muscle_standard;
+};
+
+// One finished measurement as every output sink sees it. Decoded once from
+// the raw result packets; sinks never read packet bytes themselves.
+struct MeasurementResult
+{
+  uint8_t errorCode;       // ErrorType reported by the device, 0 = success
+  uint8_t totalPackets;
+  uint8_t receivedPackets;
+  ImpedanceData imp20k;    // 0.1 ohm
+  ImpedanceData imp100k;
+  BodyCompositionResult body;
+};
+
+enum ResultFieldType : uint8_t
+{
+  RF_U8,
+  RF_U16,
+  RF_I16,
+  RF_LEVEL,         // u8 rendered as low/normal/high
+  RF_BODY_TYPE_NAME // u8 rendered as body type name
+};
+
+// One value of a result packet
+struct ResultField
+{
+  const char *key;    // output key
+  const char *group;  // nested object inside the packet section, nullptr if none
+  uint8_t offset;     // byte offset in the frame
+  ResultFieldType type;
+  uint8_t decimals;   // value = raw / 10^decimals
+  const char *unit;
+  uint16_t dst;       // offset of the value in BodyCompositionResult
+};
+
+struct ResultPacketSchema
+{
+  uint8_t packageNo;
+  uint8_t length;
+  const char *section;
+  const ResultField *fields;
+  uint8_t count;
+};
+
+extern const ResultPacketSchema RESULT_SCHEMA[RESULT_PACKET_COUNT];
+
+constexpr uint8_t resultFieldWidth(ResultFieldType t)
+{
+  return (t == RF_U16 || t == RF_I16) ? 2 : 1;
+}
+
+// Decode every received packet into `out` in one pass over the schema
+void decodeResultPackets(const ResultPackets &packets, BodyCompositionResult &out);
+
+// Build the full result (packets + the impedance sent in D0)
+void decodeMeasurementResult(const ResultPackets &packets, const ImpedanceData &imp20k,
+                             const ImpedanceData &imp100k, MeasurementResult &out);
+
+// Raw (scaled) value of field `f`
+int32_t resultValue(const BodyCompositionResult &r, const ResultField &f);
+
+// Binary result, little-endian:
+//   [0] RESULT_BIN_MARKER  [1] RESULT_SCHEMA_VERSION  [2] error code  [3] packet mask
+//   [4..43] impedance 20 kHz then 100 kHz (RH LH TR RF LF), u32 in 0.1 ohm
+//   then for every packet in the mask (bit i = 0x51+i) its schema fields in
+//   table order at their native width; name fields are not sent.
+// On error only the 4 byte header is sent.
+const uint8_t RESULT_BIN_MARKER = 0xB5; // never '{', so the app can tell it from JSON
+const size_t RESULT_BIN_HEADER = 4;
+const size_t RESULT_BIN_MAX = 236;
+
+size_t encodeResultBinary(const MeasurementResult &r, uint8_t *out);
+
+#endif // RESULT_SCHEMA_H
@@ -0,0 +1,68 @@
+#ifndef RESULT_SINK_H
+#define RESULT_SINK_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "result_schema.h"
+#include "json_writer.h"
+
+// Output for finished measurements. Every sink renders the same decoded
+// MeasurementResult; none of them looks at raw packet bytes.
+class ResultSink
+{
+public:
+  virtual ~ResultSink() {}
+  virtual void deliver(const MeasurementResult &r) = 0;
+};
+
+// Pretty JSON on the Serial console
+class SerialResultSink : public ResultSink
+{
+public:
+  void deliver(const MeasurementResult &r) override;
+};
+
+// JSON or the packed binary layout, as negotiated in the start command,
+// handed to the BLE TX stream (MTU-sized notifications, sent by the output
+// loop)
+class BleResultSink : public ResultSink
+{
+public:
+  void setFormat(ResultFormat f) { format = f; }
+  void deliver(const MeasurementResult &r) override;
+
+private:
+  ResultFormat format = RESULT_FORMAT_JSON;
+};
+
+// Last RESULT_HISTORY_SIZE results kept in RAM
+class ResultHistory : public ResultSink
+{
+public:
+  void deliver(const MeasurementResult &r) override;
+  size_t count() const { return stored; }
+  // age 0 = newest; nullptr when there is no such entry
+  const MeasurementResult *get(size_t age) const;
+
+private:
+  MeasurementResult entries[RESULT_HISTORY_SIZE];
+  size_t next = 0;
+  size_t stored = 0;
+};
+
+extern SerialResultSink serialResultSink;
+extern BleResultSink bleResultSink;
+extern ResultHistory resultHistory;
+
+// Hand a finished result to every sink
+void publishResult(const MeasurementResult &r);
+
+// Write the result document (status, impedance, decoded 0x51-0x55 packets).
+// Lives in result_json.cpp, which has no hardware dependencies.
+void writeResultJSON(JsonWriter &w, const MeasurementResult &r);
+
+const char *getBodyTypeString(uint8_t typeCode);
+const char *getErrorTypeString(uint8_t errorCode);
+const char *getStdLevelString(uint8_t level);
+
+#endif // RESULT_SINK_H
@@ -0,0 +1,196 @@
+#ifndef STABILITY_H
+#define STABILITY_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+// Weight stability detectors. All detectors are fed the same samples
+// (grams); WEIGHT_STABILITY_MODE picks the one that locks the
+// weight, the others run alongside until the user steps off so a session
+// report compares them.
+enum StabilityMode : uint8_t
+{
+  STABILITY_CONSECUTIVE, // N consecutive samples within a band of an anchor
+  STABILITY_WINDOW,      // sliding window spread + trend
+  STABILITY_PREDICTIVE,  // extrapolated asymptote of the settling curve
+  STABILITY_MODE_COUNT
+};
+
+class StabilityDetector
+{
+public:
+  virtual ~StabilityDetector() {}
+  virtual const char *name() const = 0;
+  virtual void reset() = 0;
+  // Feed one sample; true once the detector considers the value stable
+  virtual bool addSample(long value) = 0;
+  // Best estimate of the weight so far (the locked value once stable)
+  virtual long value() const = 0;
+  // Progress towards lock, reported as stable_count: 0..STABLE_REQUIRED_CNT,
+  // STABLE_REQUIRED_CNT once locked, whatever the detector (the range of the
+  // legacy counter, which app progress bars are scaled to)
+  virtual int progress() const = 0;
+  // How much the detector trusts value(), 0..100
+  virtual uint8_t confidence() const = 0;
+};
+
+// Legacy rule: STABLE_REQUIRED_CNT consecutive samples within
+// STABLE_WEIGHT_DELTA of an anchor, one outlier starts over
+class ConsecutiveStability : public StabilityDetector
+{
+public:
+  const char *name() const override { return "consecutive"; }
+  void reset() override;
+  bool addSample(long v) override;
+  long value() const override { return last; }
+  int progress() const override { return (count < STABLE_REQUIRED_CNT) ? count : STABLE_REQUIRED_CNT; }
+  uint8_t confidence() const override;
+
+private:
+  bool hasAnchor = false;
+  long anchor = 0;
+  long last = 0;
+  int count = 0;
+};
+
+// Ring of the last STABILITY_WINDOW_SIZE samples with running sums. Stable when
+// STABILITY_CONFIDENCE_Z standard deviations fit in STABILITY_TOLERANCE and
+// the mean of the newer half is within STABILITY_TREND_MAX of the older half.
+class WindowStability : public StabilityDetector
+{
+public:
+  const char *name() const override { return "window"; }
+  void reset() override;
+  bool addSample(long v) override;
+  long value() const override;
+  // first half while the window fills, second half follows the confidence
+  int progress() const override
+  {
+    return count * (STABLE_REQUIRED_CNT / 2) / STABILITY_WINDOW_SIZE +
+           conf * (STABLE_REQUIRED_CNT - STABLE_REQUIRED_CNT / 2) / 100;
+  }
+  uint8_t confidence() const override { return conf; }
+
+private:
+  static const uint8_t HALF = STABILITY_WINDOW_SIZE / 2;
+
+  long samples[STABILITY_WINDOW_SIZE];
+  uint8_t head = 0; // oldest sample once the window is full
+  uint8_t count = 0;
+  long long sum = 0;
+  long long sumSq = 0;
+  long sumOld = 0; // older half of the window
+  long sumNew = 0; // newer half of the window
+  uint8_t conf = 0;
+};
+
+static_assert(STABILITY_WINDOW_SIZE >= 4 && STABILITY_WINDOW_SIZE % 2 == 0, "STABILITY_WINDOW_SIZE must be even and >= 4");
+
+// Fits the settling curve y[k] = c + r*y[k-1] (an exponential towards
+// W = c / (1 - r)) by least squares over exponentially forgotten sums, and
+// locks when PREDICT_CONFIRM predictions in a row stay within
+// PREDICT_TOLERANCE of their running mean. O(1) work and fixed memory.
+class PredictiveStability : public StabilityDetector
+{
+public:
+  const char *name() const override { return "predictive"; }
+  void reset() override;
+  bool addSample(long v) override;
+  long value() const override;
+  int progress() const override
+  {
+    return ((agree < PREDICT_CONFIRM) ? agree : PREDICT_CONFIRM) * STABLE_REQUIRED_CNT / PREDICT_CONFIRM;
+  }
+  uint8_t confidence() const override;
+
+private:
+  bool hasSample = false;
+  long base = 0;        // first sample, keeps the float sums small
+  float prev = 0;       // previous sample - base
+  float s1 = 0, sx = 0, sy = 0, sxx = 0, sxy = 0; // forgotten LS sums
+  uint16_t samples = 0;
+  bool predicted = false;
+  float mean = 0;       // running mean of the predictions
+  float drift = 0;      // running mean |prediction - mean|
+  uint8_t agree = 0;    // predictions in a row within tolerance
+};
+
+// Impedance channels in B1 frame order
+enum ImpedanceChannel : uint8_t
+{
+  IMP_RH,
+  IMP_LH,
+  IMP_TRUNK,
+  IMP_RF,
+  IMP_LF,
+  IMP_CHANNELS
+};
+
+// Five-lane impedance stability. Every statistic is an array over the
+// channels (struct of arrays), so each update is one loop over five lanes.
+// A lane locks when z * stddev of its window and the drift between the
+// window halves fit in IMP_TOLERANCE_PPM of its mean; a locked lane keeps
+// its value and the set is done when all lanes have locked.
+class ImpedanceStability
+{
+public:
+  void reset();
+  // Feed one B1 reading; true once every channel has locked
+  bool addSample(const uint32_t (&v)[IMP_CHANNELS]);
+  bool locked() const { return lockedMask == ALL_LOCKED; }
+  uint8_t lockedChannels() const { return lockedMask; }
+  uint16_t samples() const { return total; }
+  // Locked values (valid once locked())
+  void result(ImpedanceData &out) const;
+  void printStatus() const;
+
+private:
+  static const uint8_t HALF = IMP_WINDOW_SIZE / 2;
+  static const uint8_t ALL_LOCKED = (1 << IMP_CHANNELS) - 1;
+
+  uint32_t window[IMP_WINDOW_SIZE][IMP_CHANNELS]; // ring, one row per sample
+  uint32_t sum[IMP_CHANNELS];
+  uint64_t sumSq[IMP_CHANNELS];
+  uint32_t sumOld[IMP_CHANNELS]; // older half of the window
+  uint32_t sumNew[IMP_CHANNELS]; // newer half of the window
+  uint32_t value[IMP_CHANNELS];  // latched when the lane locks
+  uint16_t lockAt[IMP_CHANNELS]; // sample count at lock
+  uint8_t head = 0;
+  uint8_t count = 0;
+  uint8_t lockedMask = 0;
+  uint16_t total = 0;
+};
+
+static_assert(IMP_WINDOW_SIZE >= 4 && IMP_WINDOW_SIZE % 2 == 0, "IMP_WINDOW_SIZE must be even and >= 4");
+
+// Per-session comparison, printed when the user steps off
+struct StabilityReport
+{
+  unsigned long startMs;
+  unsigned long lockMs[STABILITY_MODE_COUNT]; // time to lock, 0 = never locked
+  long lockValue[STABILITY_MODE_COUNT];
+  uint8_t lockConfidence[STABILITY_MODE_COUNT]; // 0..100
+  bool forced;       // active detector gave up after STABILITY_MAX_LOCK_MS
+  // locked on samples taken after the measurement (WAIT_SCALE_EMPTY), its
+  // time includes the impedance phase
+  bool afterMeasurement[STABILITY_MODE_COUNT];
+  long refSum;       // settled reference: samples taken after the measurement
+  uint8_t refCount;  // while the user is still on the scale
+};
+
+// Start a new weighing (user just stepped on)
+void weightStabilityBegin();
+// Feed a sample; true when the active detector locks (or the max lock time
+// passed), `locked` then holds the weight to use
+bool weightStabilityAdd(long value, long &locked);
+int weightStabilityProgress();
+// Confidence of the locked weight, 0..100
+uint8_t weightStabilityConfidence();
+// Sample taken after the measurement, while the user is still on the scale:
+// the settled reference, and more samples for the detectors not locked yet
+void weightStabilityReference(long value);
+void printStabilityReport();
+const StabilityReport &stabilityReport();
+
+#endif // STABILITY_H
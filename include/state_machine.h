@@ -7,23 +7,37 @@
 // State machine context
 struct StateMachineContext {
   State currentState;
-  unsigned long lastPollSendMs;
-  bool ack_A0_received;
-  bool ack_B0_received;
-  bool ack_B0_2_received;
-  
+  unsigned long stateEnteredMs;
+
   UserInfo userInfo;
   MeasurementData mData;
   CalibData calib;
 };
 
+// Time spent per state (since the last session start)
+struct StateTiming {
+  uint32_t entries;
+  uint32_t totalMs;
+  uint32_t maxMs;
+};
+
 // Initialize state machine
 void initStateMachine(StateMachineContext &ctx);
 
-// Process state machine
+// Poll events: A1/B1 loops and failing transactions. Call every loop after
+// timersRun(); the state timeout and the idle poll are timer jobs
+// (TIMER_STATE, TIMER_IDLE_POLL) armed on each transition.
 void processStateMachine(StateMachineContext &ctx);
 
-// Handle JSON input
+// Frame events: match the frame to its transaction, process it and
+// dispatch whatever it completes
+void stateMachineOnFrame(const FrameView &frame, StateMachineContext &ctx);
+
+// Command event: handle JSON input
 void handleJsonInput(const String &jsonStr, StateMachineContext &ctx);
 
+const char *stateName(State s);
+const StateTiming &stateTiming(State s);
+void printStateTimings();
+
 #endif // STATE_MACHINE_H
@@ -0,0 +1,52 @@
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include <Arduino.h>
+#include "transaction.h"
+
+// Cooperative deadline timers for the protocol side. Deadlines are
+// absolute (micros), so a periodic timer keeps its cadence however late
+// the loop runs it, and the loop can sleep until the next deadline.
+// Jobs run from timersRun(), never from an interrupt.
+
+enum TimerId : uint8_t
+{
+  TIMER_STATE,     // state timeout (RESULT_WAIT_MS, DONE_HOLD_MS)
+  TIMER_IDLE_POLL, // auto-zero A1 while idle
+  TIMER_POLL,      // A1/B1 loop: gap after an answer, or the learned timeout
+  TIMER_TXN,       // first of TXN_COUNT response timeouts (TIMER_TXN + TxnCommand)
+  TIMER_COUNT = TIMER_TXN + TXN_COUNT
+};
+
+typedef void (*TimerJob)(void *arg);
+
+// How late jobs ran after their deadline (microseconds)
+struct TimerStats
+{
+  uint32_t fired;
+  uint32_t missed; // periods skipped because the loop was too late
+  uint32_t lateMaxUs;
+  uint64_t lateSumUs;
+
+  uint32_t lateAvgUs() const { return fired ? (uint32_t)(lateSumUs / fired) : 0; }
+};
+
+// One-shot: run job (may be nullptr, then the timer only expires) delayMs
+// from now. Re-arming a timer replaces its deadline.
+void timerOnce(TimerId id, uint32_t delayMs, TimerJob job = nullptr, void *arg = nullptr);
+// Periodic: every periodMs, first one periodMs from now
+void timerEvery(TimerId id, uint32_t periodMs, TimerJob job, void *arg = nullptr);
+void timerCancel(TimerId id);
+bool timerArmed(TimerId id);
+
+// Run every job whose deadline has passed (call every loop)
+void timersRun();
+// Milliseconds until the next deadline (rounded up, 0 when one is due),
+// UINT32_MAX when nothing is armed
+uint32_t timerNextMs();
+
+const TimerStats &timerStats(TimerId id);
+void printTimerStats();
+void resetTimerStats();
+
+#endif // TIMERS_H
@@ -0,0 +1,67 @@
+#ifndef TRANSACTION_H
+#define TRANSACTION_H
+
+#include <Arduino.h>
+#include "buffer.h"
+
+// Commands tracked as request/response transactions
+enum TxnCommand : uint8_t
+{
+  TXN_A0,       // handshake
+  TXN_A1,       // weight poll
+  TXN_B0_20K,   // impedance mode start (03)
+  TXN_B0_100K,  // impedance mode second phase (06)
+  TXN_B1,       // impedance poll
+  TXN_D0,       // user data + impedances, answered by result packets
+  TXN_COUNT
+};
+
+enum TxnStatus : uint8_t
+{
+  TXN_IDLE,
+  TXN_PENDING,
+  TXN_DONE,
+  TXN_FAILED // no response after all retries
+};
+
+// Round-trip latency histogram (frame written to the UART -> response processed)
+const size_t TXN_HIST_BUCKETS = 8;
+
+struct TxnLatencyStats
+{
+  uint32_t count;
+  uint32_t timeouts;
+  uint32_t retries;
+  uint32_t lastUs;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t sumUs;
+  uint32_t buckets[TXN_HIST_BUCKETS]; // upper bounds in TXN_HIST_BOUNDS_MS
+
+  uint32_t avgUs() const { return count ? (uint32_t)(sumUs / count) : 0; }
+};
+
+extern const uint16_t TXN_HIST_BOUNDS_MS[TXN_HIST_BUCKETS - 1];
+
+// Send a command and start tracking it. D0 passes its sealed frame (copied,
+// kept for its retries), the fixed commands are sent from their prebuilt
+// frame in flash.
+void txnBegin(TxnCommand cmd);
+void txnBegin(TxnCommand cmd, const uint8_t *frame, size_t len);
+
+TxnStatus txnStatus(TxnCommand cmd);
+uint8_t txnConsecutiveFailures(TxnCommand cmd);
+
+// Match a received frame against the outstanding requests
+void txnOnFrame(const FrameView &frame);
+// Timeouts and retries run from the TIMER_TXN timers (timers.h)
+
+// Cancel everything (session start / abort)
+void txnReset();
+
+const TxnLatencyStats &txnLatency(TxnCommand cmd);
+const char *txnName(TxnCommand cmd);
+void printTxnStats();
+void resetTxnStats();
+
+#endif // TRANSACTION_H
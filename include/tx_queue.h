@@ -0,0 +1,54 @@
+#ifndef TX_QUEUE_H
+#define TX_QUEUE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Called by pumpTx() right after the frame went to the UART
+typedef void (*TxWrittenFn)(void *arg, uint32_t writeUs);
+
+// One frame slot of the transmit pool
+struct TxSlot
+{
+  enum State : uint8_t
+  {
+    FREE,
+    QUEUED // waiting for room in the UART TX FIFO
+  };
+
+  const uint8_t *data;        // frame to write: `copy`, or a constant frame
+  uint8_t copy[TX_SLOT_SIZE]; // runtime frames only
+  uint8_t len;
+  State state;
+  uint32_t seq;
+  uint32_t enqueueUs; // accepted by txEnqueue()
+  TxWrittenFn onWritten;
+  void *arg;
+};
+
+struct TxQueueStats
+{
+  uint32_t sent;
+  uint32_t dropped;   // enqueue refused, pool full of queued frames
+  uint32_t maxWaitUs; // longest enqueue -> write delay
+  uint64_t waitSumUs;
+
+  uint32_t avgWaitUs() const { return sent ? (uint32_t)(waitSumUs / sent) : 0; }
+};
+
+// Queue a frame and return immediately. Returns its sequence number,
+// 0 if the pool is full. The bytes are copied, the caller may reuse them.
+// onWritten (optional) runs when pumpTx() writes the frame, possibly
+// before txEnqueue() returns.
+uint32_t txEnqueue(const uint8_t *data, size_t len, TxWrittenFn onWritten = nullptr, void *arg = nullptr);
+// Same for a frame in static storage (CmdFrame<...>::bytes): queued by
+// pointer, nothing copied
+uint32_t txEnqueueConst(const uint8_t *data, size_t len, TxWrittenFn onWritten = nullptr, void *arg = nullptr);
+
+// Write queued frames whose bytes fit in the UART TX FIFO without blocking.
+// True when frames are left waiting for room.
+bool pumpTx();
+
+const TxQueueStats &txQueueStats();
+
+#endif // TX_QUEUE_H
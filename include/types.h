@@ -18,13 +18,48 @@ enum State
   BUILD_AND_SEND_FINAL,
   WAIT_RESULT_PACKETS,
   DONE,
-  WAIT_SCALE_EMPTY
+  WAIT_SCALE_EMPTY,
+  STATE_COUNT
+};
+
+// State machine events (see the transition table in state_machine.cpp).
+// Command: user JSON. Frame: raised by processDeviceFrame or an ACK
+// completing a transaction. Timer: state timeout or a failing transaction.
+enum FsmEvent : uint8_t
+{
+  EV_NONE,
+  EV_START,         // command: user info accepted
+  EV_ACK,           // frame: the state's A0/B0 transaction answered
+  EV_TARE_DONE,     // frame: enough tare samples (or tracked zero still fresh)
+  EV_WEIGHT_ON,     // frame: weight over MIN_WEIGHT_TO_START
+  EV_WEIGHT_LOCKED, // frame: stability detector locked
+  EV_IMP_LOCKED,    // frame: all impedance channels locked
+  EV_D0_SENT,       // D0 built and queued
+  EV_RESULTS,       // frame: last D0 result packet stored
+  EV_SCALE_EMPTY,   // frame: weight under MAX_WEIGHT_EMPTY
+  EV_STEP_ON,       // frame: someone stepped on while kiosk profiles are queued
+  EV_TIMEOUT,       // timer: state timeout, or D0 never answered
+  EV_FAILED,        // timer: ACK or polls failing, session aborted
+  EV_COUNT
 };
 
 // Calibration data structure
 struct CalibData {
   float scale_factor;  // slope
   float offset;        // offset
+
+  // Fixed-point form, filled once by prepareCalibration():
+  // grams = (counts * slope_q - offset_q) >> slope_shift (rounded)
+  int64_t slope_q;     // grams per ADC count, scaled by 2^slope_shift
+  int64_t offset_q;    // offset * slope, same scale
+  uint8_t slope_shift;
+};
+
+// Result encoding requested by the app in the start command
+enum ResultFormat : uint8_t
+{
+  RESULT_FORMAT_JSON,
+  RESULT_FORMAT_BINARY
 };
 
 // User information from JSON
@@ -34,6 +69,7 @@ struct UserInfo
   uint8_t product_id = 0;
   uint16_t height = 0;
   uint8_t age = 0;
+  ResultFormat result_format = RESULT_FORMAT_JSON;
   bool valid = false;
 };
 
@@ -76,24 +112,36 @@ enum ErrorType : uint8_t
   ERROR_TYPE_Z_TRUNK = 0x0D
 };
 
-// Result packets storage (0x51-0x55)
+// D0 result packets 0x51..0x55 (whole frames, header to checksum)
+const uint8_t RESULT_FIRST_PACKAGE = 0x51;
+const uint8_t RESULT_PACKET_COUNT = 5;
+constexpr uint8_t RESULT_PACKET_LEN[RESULT_PACKET_COUNT] = {0x50, 0x2E, 0x3A, 0x16, 0x16};
+// Start of each packet in ResultPackets::data
+constexpr uint8_t RESULT_PACKET_OFFSET[RESULT_PACKET_COUNT] = {0x00, 0x50, 0x7E, 0xB8, 0xCE};
+const size_t RESULT_PACKETS_BYTES = 0xE4; // 228
+
+constexpr size_t resultPacketEnd(uint8_t i)
+{
+  return (i == 0) ? RESULT_PACKET_LEN[0] : resultPacketEnd(i - 1) + RESULT_PACKET_LEN[i];
+}
+static_assert(RESULT_PACKET_OFFSET[1] == resultPacketEnd(0) && RESULT_PACKET_OFFSET[2] == resultPacketEnd(1) &&
+                  RESULT_PACKET_OFFSET[3] == resultPacketEnd(2) && RESULT_PACKET_OFFSET[4] == resultPacketEnd(3),
+              "RESULT_PACKET_OFFSET does not match RESULT_PACKET_LEN");
+static_assert(RESULT_PACKETS_BYTES == resultPacketEnd(RESULT_PACKET_COUNT - 1), "RESULT_PACKETS_BYTES does not match RESULT_PACKET_LEN");
+
+// Result packets storage: exactly sized slots back to back,
+// indexed by packageNo - RESULT_FIRST_PACKAGE
 struct ResultPackets
 {
-  uint8_t packet1[256];  // 0x51
-  uint8_t packet2[256];  // 0x52
-  uint8_t packet3[256];  // 0x53
-  uint8_t packet4[256];  // 0x54
-  uint8_t packet5[256];  // 0x55
-  size_t len1, len2, len3, len4, len5;
-  bool received1, received2, received3, received4, received5;
+  uint8_t data[RESULT_PACKETS_BYTES];
+  uint8_t received_mask;  // bit i = packet 0x51+i stored
   uint8_t total_packets;  // จำนวน packet ทั้งหมด
   uint8_t received_count; // จำนวน packet ที่ได้รับแล้ว
   ErrorType error_type;   // Error from packet
   
   void reset() {
-    len1 = len2 = len3 = len4 = len5 = 0;
-    received1 = received2 = received3 = received4 = received5 = false;
-    total_packets = 5;
+    received_mask = 0;
+    total_packets = RESULT_PACKET_COUNT;
     received_count = 0;
     error_type = ERROR_TYPE_NONE;
   }
@@ -105,6 +153,25 @@ struct ResultPackets
   bool hasError() const {
     return (error_type != ERROR_TYPE_NONE);
   }
+
+  // Slot index of a package number, RESULT_PACKET_COUNT when unknown
+  static uint8_t index(uint8_t packageNo) {
+    uint8_t i = (uint8_t)(packageNo - RESULT_FIRST_PACKAGE);
+    return (i < RESULT_PACKET_COUNT) ? i : RESULT_PACKET_COUNT;
+  }
+
+  // Access packet 0x51+i by index (i = 0..4)
+  const uint8_t *packet(uint8_t i) const { return &data[RESULT_PACKET_OFFSET[i]]; }
+  uint8_t *slot(uint8_t i) { return &data[RESULT_PACKET_OFFSET[i]]; }
+  size_t length(uint8_t i) const { return RESULT_PACKET_LEN[i]; }
+  bool has(uint8_t i) const { return received_mask & (1u << i); }
+
+  void markReceived(uint8_t i) {
+    if (!has(i)) {
+      received_mask |= (uint8_t)(1u << i);
+      received_count++;
+    }
+  }
 };
 
 #endif // TYPES_H
@@ -0,0 +1,36 @@
+#ifndef UART_RX_H
+#define UART_RX_H
+
+#include <Arduino.h>
+#include <HardwareSerial.h>
+
+// RX-to-processDeviceFrame latency (microseconds)
+struct RxLatencyStats
+{
+  uint32_t count;
+  uint32_t lastUs;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t sumUs;
+
+  uint32_t avgUs() const { return count ? (uint32_t)(sumUs / count) : 0; }
+};
+
+// Hook the UART RX event callback: received bytes are pushed into rxRing
+// from the UART event task and the calling task is woken when a complete
+// frame may be buffered.
+void beginUartRx(HardwareSerial &port);
+
+// Sleep until the RX callback signals a possible frame or timeoutMs passes.
+// Returns true when woken by the RX callback.
+bool waitForRxFrame(uint32_t timeoutMs);
+// Wake the task sleeping in waitForRxFrame() early (e.g. a command was queued)
+void wakeRxWaiter();
+
+// Record the latency of a frame that is about to be processed
+void recordRxLatency();
+
+const RxLatencyStats &rxLatencyStats();
+void resetRxLatencyStats();
+
+#endif // UART_RX_H
@@ -0,0 +1,261 @@
+// แยกงานเป็น task: โปรโตคอล (core 1) และ BLE/ผลลัพธ์ (core 0)
+#include "app_tasks.h"
+#include "state_machine.h"
+#include "buffer.h"
+#include "uart_rx.h"
+#include "transaction.h"
+#include "tx_queue.h"
+#include "timers.h"
+#include "result_sink.h"
+#include "ble_handler.h"
+#include "live_telemetry.h"
+#include "log.h"
+
+static_assert(BLE_OUT_TEXT_MAX <= BLE_TX_STREAM_MAX, "BLE messages must fit the TX stream");
+
+struct CommandMsg
+{
+  uint16_t len;
+  char text[CMD_TEXT_MAX];
+};
+
+struct BleMsg
+{
+  uint16_t len;
+  char text[BLE_OUT_TEXT_MAX];
+};
+
+struct ResultMsg
+{
+  MeasurementResult result;
+  ResultFormat format;
+  uint32_t postedUs;
+};
+
+static QueueHandle_t commandQueue = nullptr;
+static QueueHandle_t bleQueue = nullptr;
+static QueueHandle_t resultQueue = nullptr;
+static StateMachineContext *proto = nullptr;
+static HardwareSerial *bmhPort = nullptr;
+// Written by the BT task (commands), the protocol task (BLE messages,
+// results) and the output task (result latency): every access under statsMux
+static TaskStats stats;
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+// ---- protocol side (owns *proto) ----
+
+static void pollBMHReceive()
+{
+  // Bytes are already in rxRing (pushed by the UART RX callback)
+  FrameView frame;
+  while (tryParseFrame(frame))
+  {
+    recordRxLatency();
+    stateMachineOnFrame(frame, *proto);
+    releaseFrame(frame);
+  }
+}
+
+// One protocol pass; returns how long it may sleep
+static uint32_t protocolStep()
+{
+  CommandMsg cmd;
+  while (xQueueReceive(commandQueue, &cmd, 0) == pdTRUE)
+  {
+    cmd.text[cmd.len] = '\0';
+    handleJsonInput(String(cmd.text), *proto);
+  }
+
+  // Poll incoming data from BMH device
+  pollBMHReceive();
+
+  // Due timers (response timeouts, state timeouts, poll gaps), then polls
+  timersRun();
+  processStateMachine(*proto);
+
+  // Write frames still waiting for the UART
+  if (pumpTx())
+    return 1;
+
+  // Until the next deadline, unless a frame or a command comes first
+  uint32_t next = timerNextMs();
+  return (next < LOOP_IDLE_MS) ? next : LOOP_IDLE_MS;
+}
+
+// ---- output side (owns bleHandler TX, the result sinks, live samples) ----
+
+static void deliverResult(const ResultMsg &m)
+{
+  uint32_t picked = micros();
+  bleResultSink.setFormat(m.format);
+  publishResult(m.result);
+  uint32_t done = micros();
+
+  uint32_t queuedUs = picked - m.postedUs;
+  uint32_t doneUs = done - m.postedUs;
+  portENTER_CRITICAL(&statsMux);
+  stats.resultQueuedUs = queuedUs;
+  stats.resultDoneUs = doneUs;
+  if (doneUs > stats.resultDoneMaxUs)
+    stats.resultDoneMaxUs = doneUs;
+  uint32_t maxUs = stats.resultDoneMaxUs;
+  portEXIT_CRITICAL(&statsMux);
+  // reported here, once every sink has the result: the session-end report
+  // on the protocol task can run before this
+  LOG_INFO("Result latency: last %lu us, max %lu us (queued %lu us)",
+           (unsigned long)doneUs, (unsigned long)maxUs, (unsigned long)queuedUs);
+}
+
+// The BLE TX stream is paced by the handler, one notification per pass
+// when due: nothing here waits on the link, so live samples keep going out
+// while a result streams. The next message starts once the stream is free.
+static void outputStep(uint32_t waitMs)
+{
+  bleHandler.serviceTx();
+
+  static ResultMsg result; // too big for the stack of every caller
+  BleMsg msg;
+  if (!bleHandler.txBusy())
+  {
+    if (xQueueReceive(bleQueue, &msg, 0) == pdTRUE)
+      bleHandler.sendBytes((const uint8_t *)msg.text, msg.len);
+    else if (xQueueReceive(resultQueue, &result, 0) == pdTRUE)
+      deliverResult(result);
+    else if (xQueueReceive(bleQueue, &msg, pdMS_TO_TICKS(waitMs)) == pdTRUE)
+      bleHandler.sendBytes((const uint8_t *)msg.text, msg.len);
+  }
+  else if (waitMs > 0)
+  {
+    uint32_t due = bleHandler.txDueInMs();
+    vTaskDelay(pdMS_TO_TICKS((due < waitMs) ? due : waitMs));
+  }
+
+  liveService();
+}
+
+#if TASK_SPLIT
+static void protocolTask(void *)
+{
+  beginUartRx(*bmhPort); // RX callback wakes this task
+  for (;;)
+    waitForRxFrame(protocolStep());
+}
+
+static void outputTask(void *)
+{
+  for (;;)
+    outputStep(OUTPUT_IDLE_MS);
+}
+#endif
+
+void appTasksBegin(StateMachineContext &ctx, HardwareSerial &bmh)
+{
+  proto = &ctx;
+  bmhPort = &bmh;
+  commandQueue = xQueueCreate(CMD_QUEUE_DEPTH, sizeof(CommandMsg));
+  bleQueue = xQueueCreate(BLE_OUT_QUEUE_DEPTH, sizeof(BleMsg));
+  resultQueue = xQueueCreate(RESULT_QUEUE_DEPTH, sizeof(ResultMsg));
+
+#if TASK_SPLIT
+  xTaskCreatePinnedToCore(protocolTask, "proto", PROTO_TASK_STACK, nullptr,
+                          PROTO_TASK_PRIORITY, nullptr, PROTO_TASK_CORE);
+  xTaskCreatePinnedToCore(outputTask, "output", OUTPUT_TASK_STACK, nullptr,
+                          OUTPUT_TASK_PRIORITY, nullptr, OUTPUT_TASK_CORE);
+  LOG_INFO("Tasks: protocol on core %d, output on core %d", PROTO_TASK_CORE, OUTPUT_TASK_CORE);
+#else
+  beginUartRx(bmh);
+  LOG_INFO("Tasks: single loop() layout");
+#endif
+}
+
+void appTasksLoop()
+{
+#if TASK_SPLIT
+  vTaskDelay(pdMS_TO_TICKS(LOOP_IDLE_MS));
+#else
+  uint32_t sleepMs = protocolStep();
+  outputStep(0);
+  // live samples held back by the rate limit are sent from this loop too
+  waitForRxFrame((sleepMs < OUTPUT_IDLE_MS) ? sleepMs : OUTPUT_IDLE_MS);
+#endif
+}
+
+bool postCommand(const String &json)
+{
+  if (!commandQueue)
+    return false; // before appTasksBegin()
+  CommandMsg cmd;
+  cmd.len = (uint16_t)min((size_t)json.length(), (size_t)CMD_TEXT_MAX - 1);
+  memcpy(cmd.text, json.c_str(), cmd.len);
+  if (xQueueSend(commandQueue, &cmd, 0) != pdTRUE)
+  {
+    portENTER_CRITICAL(&statsMux);
+    stats.commandsDropped++;
+    portEXIT_CRITICAL(&statsMux);
+    LOG_WARN("Command queue full, input dropped");
+    return false;
+  }
+  wakeRxWaiter();
+  return true;
+}
+
+bool postBleJson(const String &json)
+{
+  if (!bleQueue)
+    return false;
+  if (json.length() > BLE_OUT_TEXT_MAX)
+  {
+    LOG_WARN("BLE message too long (%u bytes), dropped", (unsigned)json.length());
+    portENTER_CRITICAL(&statsMux);
+    stats.messagesDropped++;
+    portEXIT_CRITICAL(&statsMux);
+    return false;
+  }
+  BleMsg msg;
+  msg.len = (uint16_t)json.length();
+  memcpy(msg.text, json.c_str(), msg.len);
+  bool sent = xQueueSend(bleQueue, &msg, 0) == pdTRUE;
+  uint8_t waiting = (uint8_t)uxQueueMessagesWaiting(bleQueue);
+  portENTER_CRITICAL(&statsMux);
+  if (!sent)
+    stats.messagesDropped++; // the app is behind: drop, never wait
+  else if (waiting > stats.messagesHighWater)
+    stats.messagesHighWater = waiting;
+  portEXIT_CRITICAL(&statsMux);
+  return sent;
+}
+
+bool postResult(const MeasurementResult &r, ResultFormat format)
+{
+  if (!resultQueue)
+    return false;
+  static ResultMsg msg;
+  msg.result = r;
+  msg.format = format;
+  msg.postedUs = micros();
+  if (xQueueSend(resultQueue, &msg, 0) != pdTRUE)
+  {
+    portENTER_CRITICAL(&statsMux);
+    stats.resultsDropped++;
+    portEXIT_CRITICAL(&statsMux);
+    LOG_WARN("Result queue full, result dropped");
+    return false;
+  }
+  return true;
+}
+
+TaskStats taskStats()
+{
+  portENTER_CRITICAL(&statsMux);
+  TaskStats s = stats;
+  portEXIT_CRITICAL(&statsMux);
+  return s;
+}
+
+void printTaskStats()
+{
+  TaskStats s = taskStats();
+  LOG_INFO("Queues: commands dropped=%lu, BLE messages dropped=%lu (high water %u/%u), results dropped=%lu",
+           (unsigned long)s.commandsDropped, (unsigned long)s.messagesDropped,
+           s.messagesHighWater, BLE_OUT_QUEUE_DEPTH, (unsigned long)s.resultsDropped);
+}
@@ -0,0 +1,94 @@
+// ติดตามจุดศูนย์ของตาชั่งตอนว่าง
+#include "auto_zero.h"
+#include "config.h"
+#include "log.h"
+#include "calibration.h"
+#include <Preferences.h>
+
+static Preferences prefs;
+
+static bool valid = false;
+static int32_t zeroQ = 0;        // zero << AUTO_ZERO_SHIFT (filter state)
+static uint16_t confirmed = 0;   // readings accepted since boot (saturating)
+static uint32_t lastMs = 0;      // last accepted reading
+static int32_t savedZero = 0;    // value currently in NVS
+static uint32_t lastSaveMs = 0;
+static bool everSaved = false;
+
+static int32_t zero()
+{
+  return zeroQ >> AUTO_ZERO_SHIFT;
+}
+
+static void persist(const CalibData *calib, bool force)
+{
+  uint32_t now = millis();
+  if (everSaved && !force)
+  {
+    // limit flash wear: only real moves, and not too often
+    if (now - lastSaveMs < AUTO_ZERO_SAVE_MS)
+      return;
+    if (calib && labs(adcSpanToGrams(*calib, zero() - savedZero)) < AUTO_ZERO_SAVE_G)
+      return;
+  }
+  if (everSaved && zero() == savedZero)
+    return;
+  savedZero = zero();
+  prefs.putInt("zero", savedZero);
+  lastSaveMs = now;
+  everSaved = true;
+  LOG_INFO("Auto-zero saved: %ld ADC units", (long)savedZero);
+}
+
+void autoZeroBegin()
+{
+  prefs.begin("autozero", false);
+  if (prefs.isKey("zero"))
+  {
+    savedZero = prefs.getInt("zero", 0);
+    zeroQ = savedZero << AUTO_ZERO_SHIFT;
+    valid = true;
+    everSaved = true;
+    lastSaveMs = millis();
+    LOG_INFO("Auto-zero loaded: %ld ADC units (unconfirmed)", (long)savedZero);
+  }
+}
+
+void autoZeroSample(uint32_t adcRaw, const CalibData &calib)
+{
+  // no zero yet: wait for a full tare to seed it
+  if (!AUTO_ZERO_ENABLED || !valid)
+    return;
+
+  int32_t raw = (int32_t)adcRaw;
+  if (labs(adcSpanToGrams(calib, raw - zero())) > AUTO_ZERO_BAND_G)
+    return; // something on the scale, or a jump the filter must not follow
+
+  zeroQ += ((raw << AUTO_ZERO_SHIFT) - zeroQ) >> AUTO_ZERO_SHIFT;
+  if (confirmed < 0xFFFF)
+    confirmed++;
+  lastMs = millis();
+  persist(&calib, false);
+}
+
+void autoZeroSet(long offset)
+{
+  zeroQ = (int32_t)offset << AUTO_ZERO_SHIFT;
+  valid = true;
+  // a full tare averages TARE_SAMPLES readings, it counts as confirmed
+  if (confirmed < AUTO_ZERO_MIN_SAMPLES)
+    confirmed = AUTO_ZERO_MIN_SAMPLES;
+  lastMs = millis();
+  persist(nullptr, true);
+}
+
+bool autoZeroFresh()
+{
+  return AUTO_ZERO_ENABLED && valid && confirmed >= AUTO_ZERO_MIN_SAMPLES &&
+         millis() - lastMs <= AUTO_ZERO_FRESH_MS;
+}
+
+long autoZeroOffset()
+{
+  return zero();
+}
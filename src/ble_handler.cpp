@@ -1,4 +1,5 @@
 #include "ble_handler.h"
+#include "log.h"
 
 // Security callbacks
 class MySecurityCallbacks : public BLESecurityCallbacks {
@@ -74,8 +75,7 @@ public:
         std::string value = pCharacteristic->getValue();
         if (value.length() > 0) {
             String data = String(value.c_str());
-            Serial.println("BLE Data Received:");
-            Serial.println(data);
+            LOG_DEBUG("BLE data received: %u bytes", (unsigned)data.length());
             
             if (handler->dataCallback) {
                 handler->dataCallback(data);
@@ -84,13 +84,44 @@ public:
     }
 };
 
+// Live characteristic writes: [rate Hz] or [rate Hz, deadband in 10 g]
+class LiveCallbacks: public BLECharacteristicCallbacks {
+    BLEHandler* handler;
+public:
+    LiveCallbacks(BLEHandler* h) : handler(h) {}
+    
+    void onWrite(BLECharacteristic *pCharacteristic) {
+        std::string value = pCharacteristic->getValue();
+        if (value.length() < 1) {
+            return;
+        }
+        uint8_t rate = (uint8_t)value[0];
+        if (rate < LIVE_RATE_MIN_HZ) rate = LIVE_RATE_MIN_HZ;
+        if (rate > LIVE_RATE_MAX_HZ) rate = LIVE_RATE_MAX_HZ;
+        handler->liveRate = rate;
+        if (value.length() >= 2) {
+            handler->liveDeadbandUnits = (uint8_t)value[1];
+        }
+        LOG_INFO("Live telemetry: %u Hz, deadband %u x 10 g",
+                 handler->liveRate, handler->liveDeadbandUnits);
+    }
+};
+
 BLEHandler::BLEHandler() 
     : bleServer(nullptr)
     , txCharacteristic(nullptr)
     , rxCharacteristic(nullptr)
+    , liveCharacteristic(nullptr)
+    , liveCccd(nullptr)
+    , liveRate(0)
+    , liveDeadbandUnits(LIVE_DEADBAND_DEFAULT)
     , dataCallback(nullptr)
     , deviceConnected(false)
     , oldDeviceConnected(false)
+    , lastNotifyMs(0)
+    , lastLiveNotifyMs(0)
+    , txLen(0)
+    , txSent(0)
 {
 }
 
@@ -111,6 +142,7 @@ void BLEHandler::begin(BLEDataCallback callback) {
 void BLEHandler::setupBLE() {
     // Initialize BLE
     BLEDevice::init(BLE_DEVICE_NAME);
+    BLEDevice::setMTU(BLE_NOTIFY_MAX + 3);
     
     // Enable encryption and bonding
     BLEDevice::setEncryptionLevel(ESP_BLE_SEC_ENCRYPT);
@@ -143,6 +175,15 @@ void BLEHandler::setupBLE() {
     );
     rxCharacteristic->setCallbacks(new CharacteristicCallbacks(this));
     
+    // Create Live Characteristic (packed realtime samples, app writes the rate)
+    liveCharacteristic = pService->createCharacteristic(
+        CHARACTERISTIC_UUID_LIVE,
+        BLECharacteristic::PROPERTY_NOTIFY | BLECharacteristic::PROPERTY_WRITE
+    );
+    liveCccd = new BLE2902();
+    liveCharacteristic->addDescriptor(liveCccd);
+    liveCharacteristic->setCallbacks(new LiveCallbacks(this));
+    
     // Start service
     pService->start();
     
@@ -173,31 +214,116 @@ void BLEHandler::saveBondedDevice(const String &address) {
     Serial.printf("Saved bonded device: %s\n", address.c_str());
 }
 
-void BLEHandler::sendData(const String &data) {
-    if (deviceConnected && txCharacteristic) {
-        // Split data if too large (BLE limit ~512 bytes per notification)
-        const size_t maxChunkSize = 512;
-        size_t dataLen = data.length();
-        size_t offset = 0;
-        
-        while (offset < dataLen) {
-            size_t chunkSize = min(maxChunkSize, dataLen - offset);
-            String chunk = data.substring(offset, offset + chunkSize);
-            
-            txCharacteristic->setValue(chunk.c_str());
-            txCharacteristic->notify();
-            
-            offset += chunkSize;
-            
-            if (offset < dataLen) {
-                delay(20); // Small delay between chunks
-            }
-        }
-        
-        Serial.println("BLE Data Sent");
-    } else {
-        Serial.println("BLE not connected, cannot send data");
+size_t BLEHandler::notifyPayloadSize() {
+    if (!deviceConnected || !bleServer) {
+        return BLE_NOTIFY_MIN;
+    }
+    size_t mtu = bleServer->getPeerMTU(bleServer->getConnId());
+    size_t payload = (mtu > 3) ? mtu - 3 : 0;
+    if (payload < BLE_NOTIFY_MIN) payload = BLE_NOTIFY_MIN;
+    if (payload > BLE_NOTIFY_MAX) payload = BLE_NOTIFY_MAX;
+    return payload;
+}
+
+bool BLEHandler::sendChunk(const uint8_t *data, size_t len) {
+    if (!deviceConnected || !txCharacteristic) {
+        return false;
+    }
+    
+    // Keep notifications apart so the stack queue does not overflow;
+    // the caller comes back later instead of waiting here
+    if (millis() - lastNotifyMs < BLE_NOTIFY_GAP_MS) {
+        return false;
+    }
+    
+    txCharacteristic->setValue((uint8_t *)data, len);
+    txCharacteristic->notify();
+    lastNotifyMs = millis();
+    return true;
+}
+
+bool BLEHandler::liveSubscribed() {
+    return deviceConnected && liveCccd && liveCccd->getNotifications();
+}
+
+bool BLEHandler::notifyLive(const uint8_t *data, size_t len) {
+    if (!liveSubscribed()) {
+        return false;
+    }
+    // Skip rather than wait: the next sample supersedes this one
+    if (millis() - lastLiveNotifyMs < BLE_NOTIFY_GAP_MS) {
+        return false;
+    }
+    
+    liveCharacteristic->setValue((uint8_t *)data, len);
+    liveCharacteristic->notify();
+    lastLiveNotifyMs = millis();
+    return true;
+}
+
+char *BLEHandler::txBuffer(size_t &cap) {
+    if (!deviceConnected || !txCharacteristic) {
+        LOG_WARN("BLE not connected, cannot send data");
+        return nullptr;
     }
+    if (txBusy()) {
+        LOG_WARN("BLE TX busy, message dropped");
+        return nullptr;
+    }
+    cap = sizeof(txStream);
+    return (char *)txStream;
+}
+
+void BLEHandler::txCommit(size_t len) {
+    txLen = (len < sizeof(txStream)) ? len : sizeof(txStream);
+    txSent = 0;
+    // first piece right away when the gap allows it
+    serviceTx();
+}
+
+bool BLEHandler::sendBytes(const uint8_t *data, size_t len) {
+    size_t cap;
+    char *buf = txBuffer(cap);
+    if (!buf) {
+        return false;
+    }
+    if (len > cap) {
+        LOG_WARN("BLE message too long (%u bytes), dropped", (unsigned)len);
+        return false;
+    }
+    memcpy(buf, data, len);
+    txCommit(len);
+    return true;
+}
+
+bool BLEHandler::sendData(const String &data) {
+    return sendBytes((const uint8_t *)data.c_str(), data.length());
+}
+
+bool BLEHandler::serviceTx() {
+    if (!txBusy()) {
+        return false;
+    }
+    if (!deviceConnected) {
+        LOG_WARN("BLE disconnected, %u of %u bytes not sent", (unsigned)(txLen - txSent), (unsigned)txLen);
+        txLen = txSent = 0;
+        return false;
+    }
+    size_t piece = min(notifyPayloadSize(), txLen - txSent);
+    if (sendChunk(txStream + txSent, piece)) {
+        txSent += piece;
+    }
+    if (txSent < txLen) {
+        return true;
+    }
+    LOG_DEBUG("BLE data sent: %u bytes", (unsigned)txLen);
+    txLen = txSent = 0;
+    return false;
+}
+
+uint32_t BLEHandler::txDueInMs() {
+    unsigned long since = millis() - lastNotifyMs;
+    return (since < BLE_NOTIFY_GAP_MS) ? BLE_NOTIFY_GAP_MS - since : 0;
 }
 
 bool BLEHandler::isConnected() {
@@ -1,117 +1,346 @@
 #include "buffer.h"
-#include "protocol.h"
+#include "log.h"
 
 // RX buffer for BMH
-static uint8_t rxBuf[RX_BUF_SIZE];
-static size_t rxHead = 0; // next write index
-static size_t rxTail = 0; // next read index
+RxRing rxRing;
+FrameDecoder frameDecoder;
 
-void pushRxByte(uint8_t b)
+uint16_t FrameView::u16(size_t i) const
 {
-  rxBuf[rxHead] = b;
-  rxHead = (rxHead + 1) % RX_BUF_SIZE;
-  // simple overflow handling: advance tail if full
-  if (rxHead == rxTail)
+  return (uint16_t)(*this)[i] | ((uint16_t)(*this)[i + 1] << 8);
+}
+
+int16_t FrameView::i16(size_t i) const
+{
+  return (int16_t)u16(i);
+}
+
+uint32_t FrameView::u32(size_t i) const
+{
+  return (uint32_t)u16(i) | ((uint32_t)u16(i + 2) << 16);
+}
+
+void FrameView::copyTo(uint8_t *dst) const
+{
+  memcpy(dst, data1, len1);
+  if (len2 > 0)
+    memcpy(dst + len1, data2, len2);
+}
+
+void RxRing::writable(RxWriteSpans &out)
+{
+  size_t h = head.load(std::memory_order_relaxed);
+  size_t space = CAPACITY - (h - tail.load(std::memory_order_acquire));
+  size_t start = h & MASK;
+  size_t first = CAPACITY - start;
+  out.data1 = &buf[start];
+  out.data2 = &buf[0];
+  if (space <= first)
+  {
+    out.len1 = space;
+    out.len2 = 0;
+  }
+  else
   {
-    rxTail = (rxTail + 1) % RX_BUF_SIZE;
+    out.len1 = first;
+    out.len2 = space - first;
   }
 }
 
-size_t rxAvailable()
+void RxRing::noteOverflow(size_t dropped)
 {
-  if (rxHead >= rxTail)
-    return rxHead - rxTail;
-  return RX_BUF_SIZE - (rxTail - rxHead);
+  overflowEvents.fetch_add(1, std::memory_order_relaxed);
+  overflowBytes.fetch_add((uint32_t)dropped, std::memory_order_relaxed);
+  gapAt.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  gapPending.store(true, std::memory_order_release);
 }
 
-bool rxPeek(size_t i, uint8_t &out)
+bool RxRing::takeOverflow(size_t &gap)
 {
-  if (i >= rxAvailable())
+  if (!gapPending.exchange(false, std::memory_order_acquire))
     return false;
-  size_t idx = (rxTail + i) % RX_BUF_SIZE;
-  out = rxBuf[idx];
+  gap = gapAt.load(std::memory_order_relaxed);
   return true;
 }
 
-bool rxRead(uint8_t &out)
+RxOverflowStats RxRing::overflowStats() const
 {
-  if (rxAvailable() == 0)
-    return false;
-  out = rxBuf[rxTail];
-  rxTail = (rxTail + 1) % RX_BUF_SIZE;
-  return true;
+  RxOverflowStats st;
+  st.events = overflowEvents.load(std::memory_order_relaxed);
+  st.bytes = overflowBytes.load(std::memory_order_relaxed);
+  return st;
 }
 
-bool tryParseFrame(uint8_t *frameBuf, size_t &frameLen)
+void RxRing::discard(size_t n)
 {
-  // Need at least header + length + order + checksum minimal
-  if (rxAvailable() < 3)
-    return false;
+  size_t avail = available();
+  size_t t = tail.load(std::memory_order_relaxed);
+  tail.store(t + ((n < avail) ? n : avail), std::memory_order_release);
+}
+
+void RxRing::view(size_t i, size_t len, FrameView &out) const
+{
+  size_t start = (readCount() + i) & MASK;
+  size_t first = CAPACITY - start;
+  out.data1 = &buf[start];
+  if (len <= first)
+  {
+    out.len1 = len;
+    out.data2 = nullptr;
+    out.len2 = 0;
+  }
+  else
+  {
+    out.len1 = first;
+    out.data2 = &buf[0];
+    out.len2 = len - first;
+  }
+}
+
+size_t pushRxBytes(const uint8_t *data, size_t len)
+{
+  RxWriteSpans w;
+  rxRing.writable(w);
+  size_t fit = (len < w.size()) ? len : w.size();
+  size_t n1 = (fit < w.len1) ? fit : w.len1;
+  memcpy(w.data1, data, n1);
+  if (fit > n1)
+    memcpy(w.data2, data + n1, fit - n1);
+  rxRing.commit(fit);
+  if (fit < len)
+    rxRing.noteOverflow(len - fit);
+  return fit;
+}
+
+size_t pushRxBytes(Stream &port, size_t len)
+{
+  // read straight into the free spans of the ring, no staging copy
+  RxWriteSpans w;
+  rxRing.writable(w);
+  size_t fit = (len < w.size()) ? len : w.size();
+  size_t n1 = (fit < w.len1) ? fit : w.len1;
+  size_t got = port.readBytes(w.data1, n1);
+  if (got == n1 && fit > n1)
+    got += port.readBytes(w.data2, fit - n1);
+  rxRing.commit(got);
 
-  // Look for 0xAA header (answer frames from device start with 0xAA)
-  bool found = false;
-  size_t avail = rxAvailable();
-  for (size_t i = 0; i < avail; ++i)
+  if (fit < len)
   {
-    uint8_t b;
-    rxPeek(i, b);
-    if (b == 0xAA)
+    // drain the excess so the UART driver buffer does not overflow as well
+    uint8_t scratch[32];
+    size_t excess = len - fit;
+    size_t left = excess;
+    while (left > 0)
     {
-      // consume preceding bytes
-      for (size_t j = 0; j < i; ++j)
-      {
-        uint8_t tmp;
-        rxRead(tmp); // drop
-      }
-      found = true;
-      break;
+      size_t n = port.readBytes(scratch, (left < sizeof(scratch)) ? left : sizeof(scratch));
+      if (n == 0)
+        break;
+      left -= n;
     }
+    rxRing.noteOverflow(excess);
   }
-  if (!found)
+  return got;
+}
+
+size_t rxAvailable()
+{
+  return rxRing.available();
+}
+
+void setRxOverflowPolicy(RxOverflowPolicy policy)
+{
+  frameDecoder.setOverflowPolicy(policy);
+}
+
+RxOverflowStats rxOverflowStats()
+{
+  return rxRing.overflowStats();
+}
+
+void FrameDecoder::reset()
+{
+  state = HUNT;
+  pos = 0;
+  frameLen = 0;
+  sum = 0;
+  publishWanted();
+}
+
+void FrameDecoder::publishWanted()
+{
+  size_t n = (state == BODY || state == CHECK) ? frameLen : MIN_FRAME_LEN;
+  wanted.store(n, std::memory_order_relaxed);
+}
+
+void FrameDecoder::resync(RxRing &ring)
+{
+  // drop only the header byte and hunt again from header+1
+  ring.discard(1);
+  counters.bytesDropped++;
+  base = ring.readCount();
+  reset();
+}
+
+// true when the current candidate frame spans the recorded overflow gap
+bool FrameDecoder::cutByGap() const
+{
+  return gapPending && base < gapAt && base + frameLen > gapAt;
+}
+
+// frame is missing bytes: drop it up to the gap and hunt from there
+void FrameDecoder::skipToGap(RxRing &ring)
+{
+  size_t n = gapAt - base;
+  ring.discard(n);
+  counters.bytesDropped += n;
+  counters.overflowErrors++;
+  gapPending = false;
+  base = ring.readCount();
+  reset();
+}
+
+void FrameDecoder::applyOverflow(RxRing &ring, size_t gap)
+{
+  switch (policy)
   {
-    // drop all
-    uint8_t tmp;
-    while (rxRead(tmp))
-      ;
-    return false;
+  case RX_OVERFLOW_DROP_NEWEST:
+    break;
+
+  case RX_OVERFLOW_DROP_OLDEST:
+  {
+    size_t n = gap - ring.readCount();
+    ring.discard(n);
+    counters.bytesDropped += n;
+    base = ring.readCount();
+    reset();
+    break;
   }
 
-  // Now rxTail points to header 0xAA
-  if (rxAvailable() < 2)
-    return false; // need length byte
-  uint8_t hdr, lengthByte;
-  rxPeek(0, hdr);
-  rxPeek(1, lengthByte);
-  
-  size_t totalFrameLen = (size_t)lengthByte;
-  // Safety: min frame length should be >= 5 or so
-  if (totalFrameLen < 5)
+  case RX_OVERFLOW_RESYNC:
+    gapPending = true;
+    gapAt = gap;
+    if ((state == BODY || state == CHECK) && cutByGap())
+      skipToGap(ring);
+    break;
+  }
+}
+
+bool FrameDecoder::next(RxRing &ring, FrameView &frame)
+{
+  size_t gap;
+  if (ring.takeOverflow(gap))
+    applyOverflow(ring, gap);
+
+  // the ring dropped old bytes under us (overflow): start over
+  if (ring.readCount() != base)
   {
-    // consume one byte to avoid infinite loop
-    uint8_t tmp;
-    rxRead(tmp);
-    return false;
+    base = ring.readCount();
+    reset();
   }
-  if (rxAvailable() < totalFrameLen)
-    return false; // wait for more data
 
-  // Read complete frame into frameBuf
-  for (size_t i = 0; i < totalFrameLen; ++i)
+  size_t avail = ring.available();
+  while (pos < avail)
   {
-    rxRead(frameBuf[i]);
+    uint8_t b = ring.peek(pos);
+    switch (state)
+    {
+    case HUNT:
+      if (b != HEADER)
+      {
+        ++pos;
+        break;
+      }
+      // consume preceding garbage in one step
+      ring.discard(pos);
+      counters.bytesDropped += pos;
+      base = ring.readCount();
+      avail = ring.available();
+      if (gapPending && base >= gapAt)
+        gapPending = false;
+      sum = b;
+      pos = 1;
+      state = LEN;
+      break;
+
+    case LEN:
+      if (b < MIN_FRAME_LEN)
+      {
+        counters.lengthErrors++;
+        resync(ring);
+        avail = ring.available();
+        break;
+      }
+      frameLen = b;
+      if (cutByGap())
+      {
+        skipToGap(ring);
+        avail = ring.available();
+        break;
+      }
+      sum += b;
+      pos = 2;
+      state = BODY;
+      publishWanted();
+      break;
+
+    case BODY:
+      sum += b;
+      if (++pos == (size_t)frameLen - 1)
+        state = CHECK;
+      break;
+
+    case CHECK:
+    {
+      uint8_t calc = (uint8_t)(0 - sum);
+      if (b == calc)
+      {
+        ring.view(0, frameLen, frame);
+        counters.framesOk++;
+        return true;
+      }
+      LOG_WARN("Frame checksum mismatch: got %02X calc %02X", b, calc);
+      counters.checksumErrors++;
+      resync(ring);
+      avail = ring.available();
+      break;
+    }
+    }
   }
-  frameLen = totalFrameLen;
 
-  // Verify checksum: check last byte is checksum
-  if (frameLen < 1)
-    return false;
-  uint8_t checksum = frameBuf[frameLen - 1];
-  uint8_t calc = computeChecksum(frameBuf, frameLen - 1);
-  if (checksum != calc)
+  if (state == HUNT && pos > 0)
   {
-    Serial.printf("Frame checksum mismatch: got %02X calc %02X\r\n", checksum, calc);
-    return false;
+    // no header anywhere: drop everything scanned
+    ring.discard(pos);
+    counters.bytesDropped += pos;
+    base = ring.readCount();
+    pos = 0;
   }
-  // Valid frame returned
-  return true;
+  return false;
+}
+
+void FrameDecoder::release(RxRing &ring, const FrameView &frame)
+{
+  ring.discard(frame.size());
+  base = ring.readCount();
+  reset();
+}
+
+bool tryParseFrame(FrameView &frame)
+{
+  return frameDecoder.next(rxRing, frame);
+}
+
+void releaseFrame(const FrameView &frame)
+{
+  frameDecoder.release(rxRing, frame);
+}
+
+const FrameStats &frameStats()
+{
+  return frameDecoder.stats();
+}
+
+void resetFrameStats()
+{
+  frameDecoder.resetStats();
 }
@@ -1,4 +1,6 @@
 #include "calibration.h"
+#include "config.h"
+#include "log.h"
 #include <EEPROM.h>
 #include <Arduino.h>
 
@@ -7,6 +9,36 @@ void loadCalibration(CalibData &calib) {
   EEPROM.get(0, calib.scale_factor); // slope
   EEPROM.get(4, calib.offset);       // offset
 
-  Serial.printf("Loaded slope=%f offset=%f\n",
-                calib.scale_factor, calib.offset);
+  LOG_INFO("Loaded slope=%f offset=%f",
+           calib.scale_factor, calib.offset);
+  prepareCalibration(calib);
+}
+
+void prepareCalibration(CalibData &calib) {
+  calib.slope_q = 0;
+  calib.offset_q = 0;
+  calib.slope_shift = 0;
+  if (!isfinite(calib.scale_factor) || !isfinite(calib.offset))
+  {
+    LOG_WARN("Calibration invalid (erased EEPROM?), weight will read 0");
+    return;
+  }
+
+  // Largest shift that keeps |slope_q| below 2^CALIB_SLOPE_BITS, so
+  // counts (24-bit ADC) * slope_q stays inside int64
+  double slope_g = (double)calib.scale_factor * 1000.0;
+  int exp2 = 0;
+  frexp(fabs(slope_g), &exp2);
+  int shift = CALIB_SLOPE_BITS - exp2;
+  if (shift < 0)
+    shift = 0;
+  if (shift > 62)
+    shift = 62;
+
+  double scaled = ldexp(slope_g, shift);
+  calib.slope_q = llround(scaled);
+  calib.offset_q = llround((double)calib.offset * scaled);
+  calib.slope_shift = (uint8_t)shift;
+  LOG_INFO("Calibration Q%u: slope_q=%lld offset_q=%lld", calib.slope_shift,
+           (long long)calib.slope_q, (long long)calib.offset_q);
 }
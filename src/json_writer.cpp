@@ -0,0 +1,153 @@
+// เขียน JSON แบบสตรีม ไม่ใช้ heap
+#include "json_writer.h"
+
+JsonWriter::JsonWriter(char *buf, size_t cap, bool compact)
+    : buf(buf), cap(cap), compact(compact)
+{
+  first[0] = true;
+}
+
+JsonWriter::JsonWriter(char *buf, size_t cap, Sink sink, void *ctx, bool compact)
+    : buf(buf), cap(cap), sink(sink), ctx(ctx), compact(compact)
+{
+  first[0] = true;
+}
+
+void JsonWriter::flush()
+{
+  if (sink && pos > 0)
+    sink(ctx, buf, pos);
+  pos = 0;
+}
+
+void JsonWriter::put(char c)
+{
+  total++;
+  if (sink)
+  {
+    buf[pos++] = c;
+    if (pos == cap)
+      flush();
+  }
+  else if (used + 1 < cap) // keep room for the terminator
+  {
+    buf[used++] = c;
+  }
+}
+
+void JsonWriter::put(const char *s)
+{
+  while (*s)
+    put(*s++);
+}
+
+void JsonWriter::putFixed(int32_t raw, uint8_t decimals)
+{
+  uint32_t mag = (raw < 0) ? 0u - (uint32_t)raw : (uint32_t)raw;
+  if (raw < 0)
+    put('-');
+
+  // digits in reverse, at least one before the point
+  char digits[12];
+  uint8_t n = 0;
+  do
+  {
+    digits[n++] = '0' + mag % 10;
+    mag /= 10;
+  } while (mag > 0 || n <= decimals);
+
+  while (n > 0)
+  {
+    put(digits[--n]);
+    if (n == decimals && decimals > 0)
+      put('.');
+  }
+}
+
+void JsonWriter::member(const char *key)
+{
+  if (!first[depth])
+    put(',');
+  first[depth] = false;
+
+  if (!compact && depth > 0)
+  {
+    put('\n');
+    for (uint8_t i = 0; i < depth; i++)
+      put("  ");
+  }
+
+  if (key)
+  {
+    put('"');
+    put(key);
+    put(compact ? "\":" : "\": ");
+  }
+}
+
+void JsonWriter::beginObject(const char *key)
+{
+  member(key);
+  put('{');
+  if (depth < MAX_DEPTH)
+    depth++;
+  first[depth] = true;
+}
+
+void JsonWriter::endObject()
+{
+  if (depth == 0)
+    return;
+  depth--;
+  if (!compact)
+  {
+    put('\n');
+    for (uint8_t i = 0; i < depth; i++)
+      put("  ");
+  }
+  put('}');
+}
+
+void JsonWriter::addString(const char *key, const char *value)
+{
+  member(key);
+  put('"');
+  for (const char *s = value; *s; s++)
+  {
+    if (*s == '"' || *s == '\\')
+      put('\\');
+    put(*s);
+  }
+  put('"');
+}
+
+void JsonWriter::addInt(const char *key, int32_t value)
+{
+  member(key);
+  putFixed(value, 0);
+}
+
+void JsonWriter::addFixed(const char *key, int32_t raw, uint8_t decimals)
+{
+  member(key);
+  putFixed(raw, decimals);
+}
+
+void JsonWriter::addHex(const char *key, uint8_t value)
+{
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  member(key);
+  put("\"0x");
+  put(HEX_DIGITS[value >> 4]);
+  put(HEX_DIGITS[value & 0x0F]);
+  put('"');
+}
+
+size_t JsonWriter::finish()
+{
+  if (sink)
+    flush();
+  else if (cap > 0)
+    buf[used] = '\0';
+  return total;
+}
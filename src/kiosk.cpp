@@ -0,0 +1,112 @@
+// โหมด kiosk: คิวโปรไฟล์ผู้ใช้และสถิติจำนวนคนต่อชั่วโมง
+#include "kiosk.h"
+#include "config.h"
+#include "ble_handler.h"
+#include "app_tasks.h"
+#include "log.h"
+#include <ArduinoJson.h>
+
+static UserInfo queue[KIOSK_QUEUE_DEPTH];
+static uint8_t head = 0;
+static uint8_t count = 0;
+static bool running = false;   // run in progress
+static bool inSession = false; // a queued session is measuring
+static KioskStats stats;
+
+bool kioskEnqueue(const UserInfo &user)
+{
+  if (count >= KIOSK_QUEUE_DEPTH)
+    return false;
+  queue[(head + count) % KIOSK_QUEUE_DEPTH] = user;
+  count++;
+  return true;
+}
+
+void kioskClear()
+{
+  count = 0;
+}
+
+uint8_t kioskPending()
+{
+  return count;
+}
+
+bool kioskActive()
+{
+  return count > 0 || running;
+}
+
+bool kioskTake(UserInfo &user)
+{
+  if (count == 0)
+    return false;
+  user = queue[head];
+  head = (head + 1) % KIOSK_QUEUE_DEPTH;
+  count--;
+
+  uint32_t now = millis();
+  if (!running)
+  {
+    stats = KioskStats();
+    stats.firstStartMs = now;
+    running = true;
+  }
+  else if (stats.sessions > 0)
+  {
+    uint32_t dead = now - stats.lastDoneMs;
+    stats.deadCount++;
+    stats.deadSumMs += dead;
+    if (dead > stats.deadMaxMs)
+      stats.deadMaxMs = dead;
+  }
+  inSession = true;
+  return true;
+}
+
+void kioskSessionEnd(bool completed)
+{
+  if (!inSession)
+    return;
+  inSession = false;
+  if (completed)
+  {
+    stats.sessions++;
+    stats.lastDoneMs = millis();
+  }
+  else
+  {
+    stats.aborted++;
+  }
+  if (count == 0)
+    running = false; // queue drained: the run is over
+}
+
+const KioskStats &kioskStats()
+{
+  return stats;
+}
+
+void kioskReport()
+{
+  uint32_t perHour = stats.centiPerHour();
+  LOG_INFO("Kiosk: %u queued, %lu sessions (%lu aborted), %lu.%02lu sessions/h, dead time avg %lu ms max %lu ms",
+           count, (unsigned long)stats.sessions, (unsigned long)stats.aborted,
+           (unsigned long)(perHour / 100), (unsigned long)(perHour % 100),
+           (unsigned long)stats.deadAvgMs(), (unsigned long)stats.deadMaxMs);
+
+  if (bleHandler.isConnected())
+  {
+    StaticJsonDocument<192> doc;
+    doc["type"] = "kiosk";
+    doc["pending"] = count;
+    doc["sessions"] = stats.sessions;
+    doc["sessions_per_hour"] = perHour / 100.0;
+    doc["dead_time_avg_ms"] = stats.deadAvgMs();
+    doc["dead_time_max_ms"] = stats.deadMaxMs;
+
+    String jsonString;
+    serializeJson(doc, jsonString);
+    postBleJson(jsonString);
+  }
+}
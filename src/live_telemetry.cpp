@@ -0,0 +1,127 @@
+// ส่งน้ำหนัก realtime แบบ binary ตามอัตราที่แอปกำหนด
+#include "live_telemetry.h"
+#include "ble_handler.h"
+
+struct LiveSample
+{
+  int16_t weight; // 10 g
+  uint8_t progress;
+  uint8_t state;
+};
+
+static LiveSample pending;
+static LiveSample last;
+static bool hasPending = false;
+static bool hasLast = false;
+static uint32_t lastSentMs = 0;
+static LiveStats stats;
+// liveOffer() runs on the protocol task, liveService() on the output task
+static portMUX_TYPE liveMux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t intervalMs()
+{
+  uint8_t hz = bleHandler.liveRateHz();
+  return 1000 / (hz ? hz : LIVE_RATE_DEFAULT_HZ);
+}
+
+static bool insideDeadband(const LiveSample &s)
+{
+  if (!hasLast || s.progress != last.progress || s.state != last.state)
+    return false;
+  return abs(s.weight - last.weight) < bleHandler.liveDeadband();
+}
+
+bool liveActive()
+{
+  return bleHandler.liveSubscribed();
+}
+
+void liveOffer(int32_t weightG, int progress, State state)
+{
+  int32_t w = (weightG >= 0) ? (weightG + 5) / 10 : (weightG - 5) / 10;
+  if (w > INT16_MAX)
+    w = INT16_MAX;
+  if (w < INT16_MIN)
+    w = INT16_MIN;
+
+  LiveSample s;
+  s.weight = (int16_t)w;
+  s.progress = (progress > 255) ? 255 : (progress < 0 ? 0 : (uint8_t)progress);
+  s.state = (uint8_t)state;
+
+  portENTER_CRITICAL(&liveMux);
+  stats.offered++;
+  if (hasPending)
+    stats.coalesced++; // newer reading replaces one still waiting
+  pending = s;
+  hasPending = true;
+  portEXIT_CRITICAL(&liveMux);
+  // sent by liveService() on the output side
+}
+
+void liveService()
+{
+  if (!hasPending)
+    return;
+  bool active = liveActive();
+  uint32_t now = millis();
+  uint32_t since = now - lastSentMs;
+  uint32_t interval = intervalMs();
+
+  LiveSample sample;
+  portENTER_CRITICAL(&liveMux);
+  bool ready = hasPending;
+  sample = pending;
+  if (ready && !active)
+  {
+    hasPending = false;
+    ready = false;
+  }
+  else if (ready && hasLast && since < interval)
+  {
+    ready = false; // keep the newest reading until the slot opens
+  }
+  else if (ready && insideDeadband(sample) && since < LIVE_HEARTBEAT_MS)
+  {
+    hasPending = false;
+    stats.coalesced++;
+    ready = false;
+  }
+  portEXIT_CRITICAL(&liveMux);
+  if (!ready)
+    return;
+
+  uint8_t buf[LIVE_SAMPLE_SIZE];
+  buf[0] = (uint8_t)now;
+  buf[1] = (uint8_t)(now >> 8);
+  buf[2] = (uint8_t)(now >> 16);
+  buf[3] = (uint8_t)(now >> 24);
+  buf[4] = (uint8_t)sample.weight;
+  buf[5] = (uint8_t)((uint16_t)sample.weight >> 8);
+  buf[6] = sample.progress;
+  buf[7] = sample.state;
+  if (!bleHandler.notifyLive(buf, sizeof(buf)))
+    return; // link busy, retry on the next loop
+
+  portENTER_CRITICAL(&liveMux);
+  last = sample;
+  hasLast = true;
+  // a newer reading offered meanwhile stays pending
+  if (pending.weight == sample.weight && pending.progress == sample.progress && pending.state == sample.state)
+    hasPending = false;
+  lastSentMs = now;
+  stats.sent++;
+  portEXIT_CRITICAL(&liveMux);
+}
+
+const LiveStats &liveStats()
+{
+  return stats;
+}
+
+void resetLiveStats()
+{
+  portENTER_CRITICAL(&liveMux);
+  stats = LiveStats();
+  portEXIT_CRITICAL(&liveMux);
+}
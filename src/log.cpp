@@ -0,0 +1,392 @@
+// บันทึก log ลง ring แล้วให้ task ความสำคัญต่ำพิมพ์ออก Serial
+#include "log.h"
+#include <atomic>
+#include <ctype.h>
+
+enum LogKind : uint8_t
+{
+  LOG_KIND_FORMAT,
+  LOG_KIND_HEX,
+  LOG_KIND_TEXT
+};
+
+// Record = header + payload (argument words or hex bytes), padded to 4 bytes
+struct LogHeader
+{
+  uint8_t kind;
+  uint8_t count;  // argument words, hex or text bytes
+  uint16_t size;  // whole record in bytes
+  const char *text; // format or hex prefix (literal), unused for text
+};
+
+static const size_t LOG_MASK = LOG_RING_SIZE - 1;
+static const size_t LOG_PAYLOAD_MAX = 256;
+static const size_t LOG_LINE_MAX = 256;
+
+static_assert((LOG_RING_SIZE & LOG_MASK) == 0, "LOG_RING_SIZE must be a power of two");
+static_assert(LOG_RING_SIZE >= 2 * (sizeof(LogHeader) + LOG_PAYLOAD_MAX), "LOG_RING_SIZE too small for a hex record");
+static_assert(LOG_MAX_WORDS * 4 <= LOG_PAYLOAD_MAX, "LOG_MAX_WORDS too large");
+
+static uint8_t ring[LOG_RING_SIZE];
+static std::atomic<uint32_t> head{0}; // producers, under ringMux
+static std::atomic<uint32_t> tail{0}; // drain task
+static portMUX_TYPE ringMux = portMUX_INITIALIZER_UNLOCKED;
+static LogStats stats;
+static uint32_t reportedDropped = 0;
+static TaskHandle_t drainTask = nullptr;
+
+static void copyIn(uint32_t at, const void *src, size_t n)
+{
+  const uint8_t *s = (const uint8_t *)src;
+  size_t start = at & LOG_MASK;
+  size_t first = LOG_RING_SIZE - start;
+  if (n <= first)
+  {
+    memcpy(&ring[start], s, n);
+  }
+  else
+  {
+    memcpy(&ring[start], s, first);
+    memcpy(&ring[0], s + first, n - first);
+  }
+}
+
+static void copyOut(uint32_t at, void *dst, size_t n)
+{
+  uint8_t *d = (uint8_t *)dst;
+  size_t start = at & LOG_MASK;
+  size_t first = LOG_RING_SIZE - start;
+  if (n <= first)
+  {
+    memcpy(d, &ring[start], n);
+  }
+  else
+  {
+    memcpy(d, &ring[start], first);
+    memcpy(d + first, &ring[0], n - first);
+  }
+}
+
+// dropIfFull=false: leave a full ring uncounted, the caller waits and retries
+static bool push(LogHeader &h, const void *p1, size_t n1, const void *p2, size_t n2,
+                 bool dropIfFull = true)
+{
+  h.size = (uint16_t)((sizeof(LogHeader) + n1 + n2 + 3) & ~3u);
+  bool ok = false;
+  portENTER_CRITICAL(&ringMux);
+  uint32_t at = head.load(std::memory_order_relaxed);
+  uint32_t used = at - tail.load(std::memory_order_acquire);
+  if (h.size <= LOG_RING_SIZE - used)
+  {
+    copyIn(at, &h, sizeof(h));
+    copyIn(at + sizeof(h), p1, n1);
+    if (n2 > 0)
+      copyIn(at + sizeof(h) + n1, p2, n2);
+    head.store(at + h.size, std::memory_order_release);
+    stats.written++;
+    if (used + h.size > stats.highWater)
+      stats.highWater = (uint16_t)(used + h.size);
+    ok = true;
+  }
+  else if (dropIfFull)
+  {
+    stats.dropped++;
+  }
+  portEXIT_CRITICAL(&ringMux);
+  return ok;
+}
+
+bool logWrite(uint8_t level, const char *fmt, const uint32_t *words, uint8_t count)
+{
+  (void)level;
+  LogHeader h;
+  h.kind = LOG_KIND_FORMAT;
+  h.count = count;
+  h.text = fmt;
+  return push(h, words, count * sizeof(uint32_t), nullptr, 0);
+}
+
+bool logWriteHex(uint8_t level, const char *prefix, const uint8_t *data1, size_t len1,
+                 const uint8_t *data2, size_t len2)
+{
+  (void)level;
+  if (len1 > 255)
+    len1 = 255;
+  if (len1 + len2 > 255)
+    len2 = 255 - len1;
+  LogHeader h;
+  h.kind = LOG_KIND_HEX;
+  h.count = (uint8_t)(len1 + len2);
+  h.text = prefix;
+  return push(h, data1, len1, data2, len2);
+}
+
+static void drain();
+
+bool logText(const char *data, size_t len)
+{
+  LogHeader h;
+  h.kind = LOG_KIND_TEXT;
+  h.text = nullptr;
+  while (len > 0)
+  {
+    size_t n = (len < 255) ? len : 255;
+    h.count = (uint8_t)n;
+    uint16_t waited = 0;
+    while (!push(h, data, n, nullptr, 0, false))
+    {
+      if (!drainTask)
+      {
+        drain();
+        continue;
+      }
+      if (waited++ >= LOG_FLUSH_TIMEOUT_MS)
+      {
+        portENTER_CRITICAL(&ringMux);
+        stats.dropped++;
+        portEXIT_CRITICAL(&ringMux);
+        return false;
+      }
+      vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+// ---- drain side ----
+
+struct WordReader
+{
+  const uint32_t *w;
+  uint8_t left;
+
+  uint64_t take(size_t words)
+  {
+    uint64_t v = 0;
+    for (size_t i = 0; i < words; i++)
+    {
+      uint64_t u = left ? (left--, *w++) : 0;
+      v |= u << (32 * i);
+    }
+    return v;
+  }
+};
+
+// Expand one printf conversion from the packed words
+static int formatArg(char *out, size_t room, const char *spec, char conv, int longs, bool sized, WordReader &in)
+{
+  size_t words = (longs >= 2) ? 2 : (longs == 1) ? sizeof(long) / 4 : sized ? sizeof(size_t) / 4 : 1;
+  switch (conv)
+  {
+  case 'd':
+  case 'i':
+  {
+    int64_t v = (words == 2) ? (int64_t)in.take(2) : (int64_t)(int32_t)in.take(1);
+    if (longs >= 2)
+      return snprintf(out, room, spec, (long long)v);
+    if (longs == 1)
+      return snprintf(out, room, spec, (long)v);
+    return snprintf(out, room, spec, (int)v);
+  }
+  case 'u':
+  case 'x':
+  case 'X':
+  case 'o':
+  case 'c':
+  {
+    uint64_t v = in.take(words);
+    if (longs >= 2)
+      return snprintf(out, room, spec, (unsigned long long)v);
+    if (longs == 1)
+      return snprintf(out, room, spec, (unsigned long)v);
+    if (sized)
+      return snprintf(out, room, spec, (size_t)v);
+    return snprintf(out, room, spec, (unsigned)v);
+  }
+  case 'f':
+  case 'F':
+  case 'e':
+  case 'E':
+  case 'g':
+  case 'G':
+  {
+    uint32_t u = (uint32_t)in.take(1);
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return snprintf(out, room, spec, (double)f);
+  }
+  case 's':
+  {
+    char s[LOG_STR_MAX + 1];
+    size_t len = (size_t)in.take(1);
+    if (len > LOG_STR_MAX)
+      len = LOG_STR_MAX;
+    for (size_t i = 0; i < len; i += 4)
+    {
+      uint32_t u = (uint32_t)in.take(1);
+      memcpy(s + i, &u, (len - i < 4) ? len - i : 4);
+    }
+    s[len] = '\0';
+    return snprintf(out, room, spec, s);
+  }
+  case 'p':
+    return snprintf(out, room, spec, (void *)(uintptr_t)in.take(1));
+  default:
+    return snprintf(out, room, "%s", spec);
+  }
+}
+
+static size_t formatRecord(const LogHeader &h, const uint8_t *payload, char *line)
+{
+  size_t n = 0;
+  if (h.kind == LOG_KIND_TEXT)
+  {
+    memcpy(line, payload, h.count); // as written, newlines and all
+    return h.count;
+  }
+  if (h.kind == LOG_KIND_HEX)
+  {
+    n = snprintf(line, LOG_LINE_MAX, "%s ", h.text);
+    for (uint8_t i = 0; i < h.count && n + 4 < LOG_LINE_MAX; i++)
+      n += snprintf(line + n, LOG_LINE_MAX - n, "%02X ", payload[i]);
+  }
+  else
+  {
+    WordReader in = {(const uint32_t *)payload, h.count};
+    const char *f = h.text;
+    while (*f && n < LOG_LINE_MAX - 1)
+    {
+      if (*f != '%')
+      {
+        line[n++] = *f++;
+        continue;
+      }
+      const char *start = f++;
+      if (*f == '%')
+      {
+        line[n++] = '%';
+        f++;
+        continue;
+      }
+      while (*f && strchr("-+ #0", *f))
+        f++;
+      while (isdigit((unsigned char)*f))
+        f++;
+      if (*f == '.')
+      {
+        f++;
+        while (isdigit((unsigned char)*f))
+          f++;
+      }
+      int longs = 0;
+      bool sized = false;
+      while (*f == 'h')
+        f++;
+      while (*f == 'l')
+      {
+        longs++;
+        f++;
+      }
+      if (*f == 'z')
+      {
+        sized = true;
+        f++;
+      }
+      char conv = *f;
+      if (!conv)
+        break;
+      f++;
+
+      char spec[16];
+      size_t sl = f - start;
+      if (sl >= sizeof(spec))
+        sl = sizeof(spec) - 1;
+      memcpy(spec, start, sl);
+      spec[sl] = '\0';
+      int r = formatArg(line + n, LOG_LINE_MAX - n, spec, conv, longs, sized, in);
+      if (r > 0)
+        n += ((size_t)r < LOG_LINE_MAX - n) ? (size_t)r : LOG_LINE_MAX - n - 1;
+    }
+  }
+  if (n == 0 || line[n - 1] != '\n')
+  {
+    if (n >= LOG_LINE_MAX - 1)
+      n = LOG_LINE_MAX - 2;
+    line[n++] = '\n';
+  }
+  return n;
+}
+
+// Print everything queued (drain task, or logFlush() before it runs)
+static void drain()
+{
+  static uint8_t record[sizeof(LogHeader) + LOG_PAYLOAD_MAX];
+  static char line[LOG_LINE_MAX];
+
+  uint32_t at = tail.load(std::memory_order_relaxed);
+  while (at != head.load(std::memory_order_acquire))
+  {
+    LogHeader h;
+    copyOut(at, &h, sizeof(h));
+    copyOut(at + sizeof(h), record, h.size - sizeof(h));
+    at += h.size;
+    tail.store(at, std::memory_order_release);
+
+    size_t n = formatRecord(h, record, line);
+    Serial.write((const uint8_t *)line, n);
+  }
+
+  uint32_t dropped = stats.dropped;
+  if (dropped != reportedDropped)
+  {
+    Serial.printf("[log] %lu records dropped (ring full)\n", (unsigned long)(dropped - reportedDropped));
+    reportedDropped = dropped;
+  }
+}
+
+static void drainLoop(void *)
+{
+  for (;;)
+  {
+    drain();
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+  }
+}
+
+void logBegin()
+{
+  if (drainTask)
+    return;
+  if (xTaskCreatePinnedToCore(drainLoop, "log", LOG_TASK_STACK, nullptr, LOG_TASK_PRIORITY,
+                              &drainTask, LOG_TASK_CORE) != pdPASS)
+  {
+    drainTask = nullptr;
+    Serial.println("Log task not started, records are printed by logFlush()");
+  }
+}
+
+void logFlush()
+{
+  if (!drainTask)
+  {
+    drain();
+    return;
+  }
+  for (uint16_t waited = 0; waited < LOG_FLUSH_TIMEOUT_MS; waited++)
+  {
+    if (tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire))
+      return;
+    vTaskDelay(pdMS_TO_TICKS(1));
+  }
+}
+
+LogStats logStats()
+{
+  LogStats s;
+  portENTER_CRITICAL(&ringMux);
+  s = stats;
+  portEXIT_CRITICAL(&ringMux);
+  return s;
+}
@@ -0,0 +1,155 @@
+// ตั้งเวลาส่ง A1/B1 ตามการตอบกลับของโมดูล
+#include "poll_scheduler.h"
+#include "config.h"
+#include "state_machine.h"
+#include "timers.h"
+#include "log.h"
+
+struct PollState
+{
+  bool active;         // a phase is being tracked
+  bool counted;        // response to the last poll already counted
+  uint8_t backoff;
+  uint32_t issuedUs;
+  uint32_t dueUs; // earliest next poll: module answer + POLL_MIN_GAP_MS
+};
+
+static PollState poll;
+static PollPhaseStats phase;
+static uint32_t turnaroundUs[TXN_COUNT]; // EWMA, 0 = not learned yet
+
+static void reportPhase()
+{
+  uint32_t ms = millis() - phase.startMs;
+  if (phase.samples == 0 || ms == 0)
+    return;
+  uint32_t centiHz = (uint32_t)((uint64_t)phase.samples * 100000UL / ms);
+  LOG_INFO("Poll %s: %lu samples in %lu ms = %lu.%02lu Hz (timeouts %lu)",
+           stateName(phase.state), (unsigned long)phase.samples, (unsigned long)ms,
+           (unsigned long)(centiHz / 100), (unsigned long)(centiHz % 100),
+           (unsigned long)phase.timeouts);
+  if (phase.lateCount > 0)
+    LOG_INFO("Poll %s jitter: avg %lu us, max %lu us late", stateName(phase.state),
+             (unsigned long)(phase.lateSumUs / phase.lateCount), (unsigned long)phase.lateMaxUs);
+}
+
+void pollTrackState(State state)
+{
+  if (poll.active && state == phase.state)
+    return;
+  if (poll.active)
+    reportPhase();
+
+  poll.active = true;
+  poll.counted = true;
+  poll.backoff = 0;
+  timerCancel(TIMER_POLL);
+  phase.state = state;
+  phase.startMs = millis();
+  phase.samples = 0;
+  phase.timeouts = 0;
+  phase.lateCount = 0;
+  phase.lateSumUs = 0;
+  phase.lateMaxUs = 0;
+}
+
+static uint32_t timeoutMs(TxnCommand cmd)
+{
+  uint32_t t = TXN_POLL_TIMEOUT_MS;
+  if (turnaroundUs[cmd] != 0)
+  {
+    // a few turnarounds of margin, within [POLL_TIMEOUT_MIN_MS, TXN_POLL_TIMEOUT_MS]
+    t = 3 * turnaroundUs[cmd] / 1000 + POLL_MIN_GAP_MS;
+    if (t < POLL_TIMEOUT_MIN_MS)
+      t = POLL_TIMEOUT_MIN_MS;
+  }
+  t <<= poll.backoff;
+  return (t > TXN_POLL_TIMEOUT_MS) ? TXN_POLL_TIMEOUT_MS : t;
+}
+
+static void learn(TxnCommand cmd)
+{
+  uint32_t rtt = txnLatency(cmd).lastUs;
+  if (rtt == 0)
+    return;
+  // EWMA with alpha = 1/8
+  if (turnaroundUs[cmd] == 0)
+    turnaroundUs[cmd] = rtt;
+  else
+    turnaroundUs[cmd] = turnaroundUs[cmd] - (turnaroundUs[cmd] >> 3) + (rtt >> 3);
+}
+
+static void issue(TxnCommand cmd)
+{
+  txnBegin(cmd);
+  poll.issuedUs = micros();
+  poll.counted = false;
+  // re-issue if this one is not answered in time
+  timerOnce(TIMER_POLL, timeoutMs(cmd));
+}
+
+static void recordLateness()
+{
+  int32_t late = (int32_t)(micros() - poll.dueUs);
+  if (late < 0)
+    late = 0;
+  phase.lateCount++;
+  phase.lateSumUs += (uint32_t)late;
+  if ((uint32_t)late > phase.lateMaxUs)
+    phase.lateMaxUs = (uint32_t)late;
+}
+
+bool pollService(TxnCommand cmd)
+{
+  TxnStatus status = txnStatus(cmd);
+  if (status == TXN_PENDING && poll.counted)
+  {
+    // poll sent before this phase started: give it a full timeout
+    poll.counted = false;
+    poll.issuedUs = micros();
+    timerOnce(TIMER_POLL, timeoutMs(cmd));
+    return false;
+  }
+  if (status == TXN_DONE && !poll.counted)
+  {
+    poll.counted = true;
+    poll.backoff = 0;
+    phase.samples++;
+    learn(cmd);
+    // the frame arrived one turnaround after the poll went out
+    poll.dueUs = poll.issuedUs + txnLatency(cmd).lastUs + POLL_MIN_GAP_MS * 1000UL;
+    timerOnce(TIMER_POLL, POLL_MIN_GAP_MS); // replaces the timeout
+  }
+  // TIMER_POLL still running: in the gap, or the poll is not overdue yet
+  if (status != TXN_IDLE && timerArmed(TIMER_POLL))
+    return false;
+
+  switch (status)
+  {
+  case TXN_IDLE:
+    break;
+
+  case TXN_DONE:
+    recordLateness();
+    break;
+
+  case TXN_PENDING:
+  case TXN_FAILED:
+    phase.timeouts++;
+    if (poll.backoff < POLL_MAX_BACKOFF)
+      poll.backoff++;
+    break;
+  }
+  issue(cmd);
+  return true;
+}
+
+uint32_t pollTurnaroundUs(TxnCommand cmd)
+{
+  return turnaroundUs[cmd];
+}
+
+const PollPhaseStats &pollPhaseStats()
+{
+  return phase;
+}
@@ -0,0 +1,139 @@
+// เขียนผลการวัดเป็น JSON ตามตาราง RESULT_SCHEMA
+#include "result_sink.h"
+
+// Helper function to get body type string
+const char* getBodyTypeString(uint8_t typeCode)
+{
+  switch(typeCode)
+  {
+    case 0x01: return "Thin type";
+    case 0x02: return "Lean muscular type";
+    case 0x03: return "Muscular type";
+    case 0x04: return "Bloated obesity type";
+    case 0x05: return "Fat muscular type";
+    case 0x06: return "Muscular fat type";
+    case 0x07: return "Not athletic";
+    case 0x08: return "Standard type";
+    case 0x09: return "Standard muscle type";
+    default: return "Unknown";
+  }
+}
+
+// Helper function to get error type string
+const char* getErrorTypeString(uint8_t errorCode)
+{
+  switch(errorCode)
+  {
+    case 0x00: return "No errors";
+    case 0x01: return "Wrong age";
+    case 0x02: return "Wrong height";
+    case 0x03: return "Wrong weight";
+    case 0x04: return "Wrong gender";
+    case 0x05: return "User type error";
+    case 0x06: return "Wrong impedance of both feet";
+    case 0x07: return "Hand impedance error";
+    case 0x08: return "Left whole body impedance error";
+    case 0x09: return "Left hand impedance error";
+    case 0x0A: return "Right hand impedance error";
+    case 0x0B: return "Left foot impedance error";
+    case 0x0C: return "Right foot impedance error";
+    case 0x0D: return "Torso impedance error";
+    default: return "Unknown error";
+  }
+}
+
+// Helper to get standard level string
+const char* getStdLevelString(uint8_t level)
+{
+  switch(level)
+  {
+    case 0: return "low";
+    case 1: return "normal";
+    case 2: return "high";
+    default: return "unknown";
+  }
+}
+
+static void writeImpedanceJSON(JsonWriter &w, const char *name, const ImpedanceData &imp)
+{
+  w.beginObject(name);
+  w.addFixed("right_hand_ohm", imp.rh, 1);
+  w.addFixed("left_hand_ohm", imp.lh, 1);
+  w.addFixed("trunk_ohm", imp.trunk, 1);
+  w.addFixed("right_foot_ohm", imp.rf, 1);
+  w.addFixed("left_foot_ohm", imp.lf, 1);
+  w.endObject();
+}
+
+static bool sameGroup(const char *a, const char *b)
+{
+  return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+void writeResultJSON(JsonWriter &w, const MeasurementResult &r)
+{
+  w.beginObject();
+
+  if (r.errorCode != ERROR_TYPE_NONE)
+  {
+    w.addString("status", "error");
+    w.addHex("error_code", r.errorCode);
+    w.addString("error_message", getErrorTypeString(r.errorCode));
+    w.endObject();
+    return;
+  }
+
+  w.addString("status", "success");
+  w.addInt("total_packets", r.totalPackets);
+  w.addInt("received_packets", r.receivedPackets);
+
+  // Impedance measurements (in Ohms)
+  w.beginObject("impedance_measurements");
+  writeImpedanceJSON(w, "20khz", r.imp20k);
+  writeImpedanceJSON(w, "100khz", r.imp100k);
+  w.endObject();
+
+  // Decoded packets, walked through RESULT_SCHEMA; packets that were not
+  // received (or had a bad length) are left out
+  for (uint8_t i = 0; i < RESULT_PACKET_COUNT; i++)
+  {
+    if (!(r.body.decodedMask & (1u << i)))
+      continue;
+
+    const ResultPacketSchema &s = RESULT_SCHEMA[i];
+    w.beginObject(s.section);
+
+    const char *group = nullptr;
+    for (uint8_t k = 0; k < s.count; k++)
+    {
+      const ResultField &f = s.fields[k];
+      if (!sameGroup(f.group, group))
+      {
+        if (group)
+          w.endObject();
+        if (f.group)
+          w.beginObject(f.group);
+        group = f.group;
+      }
+
+      int32_t v = resultValue(r.body, f);
+      switch (f.type)
+      {
+      case RF_LEVEL:
+        w.addString(f.key, getStdLevelString((uint8_t)v));
+        break;
+      case RF_BODY_TYPE_NAME:
+        w.addString(f.key, getBodyTypeString((uint8_t)v));
+        break;
+      default:
+        w.addFixed(f.key, v, f.decimals);
+        break;
+      }
+    }
+    if (group)
+      w.endObject();
+    w.endObject();
+  }
+
+  w.endObject();
+}
@@ -0,0 +1,269 @@
+// ตารางโครงสร้างแพ็กเก็ตผลลัพธ์ D0 (0x51-0x55)
+#include "result_schema.h"
+#include "protocol.h"
+#include <stddef.h>
+
+#define RF(key, group, off, type, dec, unit, member) \
+  { key, group, off, type, dec, unit, (uint16_t)offsetof(BodyCompositionResult, member) }
+
+#define RF_SEGMENTS(group, first, type, dec, unit, member)                                  \
+  RF("right_hand", group, (first), type, dec, unit, member.right_hand),                     \
+  RF("left_hand", group, (first) + resultFieldWidth(type), type, dec, unit, member.left_hand), \
+  RF("trunk", group, (first) + 2 * resultFieldWidth(type), type, dec, unit, member.trunk),  \
+  RF("right_foot", group, (first) + 3 * resultFieldWidth(type), type, dec, unit, member.right_foot), \
+  RF("left_foot", group, (first) + 4 * resultFieldWidth(type), type, dec, unit, member.left_foot)
+
+// ===== PACKET 1 (0x51) - Main body composition =====
+static constexpr ResultField BODY_COMPOSITION_FIELDS[] = {
+  RF("weight_kg", nullptr, 5, RF_U16, 1, "kg", weight),
+  RF("weight_std_min_kg", nullptr, 7, RF_U16, 1, "kg", weight_std_min),
+  RF("weight_std_max_kg", nullptr, 9, RF_U16, 1, "kg", weight_std_max),
+  RF("moisture_kg", nullptr, 11, RF_U16, 1, "kg", moisture),
+  RF("moisture_std_min_kg", nullptr, 13, RF_U16, 1, "kg", moisture_std_min),
+  RF("moisture_std_max_kg", nullptr, 15, RF_U16, 1, "kg", moisture_std_max),
+  RF("body_fat_mass_kg", nullptr, 17, RF_U16, 1, "kg", body_fat_mass),
+  RF("body_fat_std_min_kg", nullptr, 19, RF_U16, 1, "kg", body_fat_std_min),
+  RF("body_fat_std_max_kg", nullptr, 21, RF_U16, 1, "kg", body_fat_std_max),
+  RF("protein_mass_kg", nullptr, 23, RF_U16, 1, "kg", protein_mass),
+  RF("protein_std_min_kg", nullptr, 25, RF_U16, 1, "kg", protein_std_min),
+  RF("protein_std_max_kg", nullptr, 27, RF_U16, 1, "kg", protein_std_max),
+  RF("inorganic_salt_kg", nullptr, 29, RF_U16, 1, "kg", inorganic_salt),
+  RF("inorganic_std_min_kg", nullptr, 31, RF_U16, 1, "kg", inorganic_std_min),
+  RF("inorganic_std_max_kg", nullptr, 33, RF_U16, 1, "kg", inorganic_std_max),
+  RF("lean_body_weight_kg", nullptr, 35, RF_U16, 1, "kg", lean_body_weight),
+  RF("lean_body_std_min_kg", nullptr, 37, RF_U16, 1, "kg", lean_body_std_min),
+  RF("lean_body_std_max_kg", nullptr, 39, RF_U16, 1, "kg", lean_body_std_max),
+  RF("muscle_mass_kg", nullptr, 41, RF_U16, 1, "kg", muscle_mass),
+  RF("muscle_std_min_kg", nullptr, 43, RF_U16, 1, "kg", muscle_std_min),
+  RF("muscle_std_max_kg", nullptr, 45, RF_U16, 1, "kg", muscle_std_max),
+  RF("bone_mass_kg", nullptr, 47, RF_U16, 1, "kg", bone_mass),
+  RF("bone_std_min_kg", nullptr, 49, RF_U16, 1, "kg", bone_std_min),
+  RF("bone_std_max_kg", nullptr, 51, RF_U16, 1, "kg", bone_std_max),
+  RF("skeletal_muscle_kg", nullptr, 53, RF_U16, 1, "kg", skeletal_muscle),
+  RF("skeletal_std_min_kg", nullptr, 55, RF_U16, 1, "kg", skeletal_std_min),
+  RF("skeletal_std_max_kg", nullptr, 57, RF_U16, 1, "kg", skeletal_std_max),
+  RF("intracellular_water_kg", nullptr, 59, RF_U16, 1, "kg", ic_water),
+  RF("ic_water_std_min_kg", nullptr, 61, RF_U16, 1, "kg", ic_water_std_min),
+  RF("ic_water_std_max_kg", nullptr, 63, RF_U16, 1, "kg", ic_water_std_max),
+  RF("extracellular_water_kg", nullptr, 65, RF_U16, 1, "kg", ec_water),
+  RF("ec_water_std_min_kg", nullptr, 67, RF_U16, 1, "kg", ec_water_std_min),
+  RF("ec_water_std_max_kg", nullptr, 69, RF_U16, 1, "kg", ec_water_std_max),
+  RF("body_cell_mass_kg", nullptr, 71, RF_U16, 1, "kg", body_cell_mass),
+  RF("bcm_std_min_kg", nullptr, 73, RF_U16, 1, "kg", bcm_std_min),
+  RF("bcm_std_max_kg", nullptr, 75, RF_U16, 1, "kg", bcm_std_max),
+  RF("subcutaneous_fat_mass_kg", nullptr, 77, RF_U16, 1, "kg", subcutaneous_fat_mass),
+};
+
+// ===== PACKET 2 (0x52) - Segmental analysis =====
+static constexpr ResultField SEGMENTAL_FIELDS[] = {
+  RF_SEGMENTS("fat_mass_kg", 5, RF_U16, 1, "kg", seg_fat_mass),
+  RF_SEGMENTS("fat_percent", 15, RF_U16, 1, "%", seg_fat_percent),
+  RF_SEGMENTS("muscle_mass_kg", 25, RF_U16, 1, "kg", seg_muscle_mass),
+  RF_SEGMENTS("muscle_ratio_percent", 35, RF_U16, 1, "%", seg_muscle_ratio),
+};
+
+// ===== PACKET 3 (0x53) - Health metrics =====
+static constexpr ResultField HEALTH_FIELDS[] = {
+  RF("body_score", nullptr, 5, RF_U8, 0, "", body_score),
+  RF("physical_age", nullptr, 6, RF_U8, 0, "years", physical_age),
+  RF("body_type", nullptr, 7, RF_U8, 0, "", body_type),
+  RF("body_type_name", nullptr, 7, RF_BODY_TYPE_NAME, 0, "", body_type),
+  RF("smi", nullptr, 8, RF_U8, 1, "kg/m2", smi),
+  RF("whr", nullptr, 9, RF_U8, 2, "", whr),
+  RF("whr_std_min", nullptr, 10, RF_U8, 2, "", whr_std_min),
+  RF("whr_std_max", nullptr, 11, RF_U8, 2, "", whr_std_max),
+  RF("visceral_fat", nullptr, 12, RF_U8, 0, "", visceral_fat),
+  RF("vf_std_min", nullptr, 13, RF_U8, 0, "", vf_std_min),
+  RF("vf_std_max", nullptr, 14, RF_U8, 0, "", vf_std_max),
+  RF("obesity_percent", nullptr, 15, RF_U16, 1, "%", obesity_percent),
+  RF("obesity_std_min", nullptr, 17, RF_U16, 1, "%", obesity_std_min),
+  RF("obesity_std_max", nullptr, 19, RF_U16, 1, "%", obesity_std_max),
+  RF("bmi", nullptr, 21, RF_U16, 1, "kg/m2", bmi),
+  RF("bmi_std_min", nullptr, 23, RF_U16, 1, "kg/m2", bmi_std_min),
+  RF("bmi_std_max", nullptr, 25, RF_U16, 1, "kg/m2", bmi_std_max),
+  RF("body_fat_percent", nullptr, 27, RF_U16, 1, "%", body_fat_percent),
+  RF("body_fat_std_min", nullptr, 29, RF_U16, 1, "%", body_fat_percent_std_min),
+  RF("body_fat_std_max", nullptr, 31, RF_U16, 1, "%", body_fat_percent_std_max),
+  RF("bmr_kcal", nullptr, 33, RF_U16, 0, "kcal", bmr),
+  RF("bmr_std_min_kcal", nullptr, 35, RF_U16, 0, "kcal", bmr_std_min),
+  RF("bmr_std_max_kcal", nullptr, 37, RF_U16, 0, "kcal", bmr_std_max),
+  RF("recommended_intake_kcal", nullptr, 39, RF_U16, 0, "kcal", recommended_intake),
+  RF("ideal_weight_kg", nullptr, 41, RF_U16, 1, "kg", ideal_weight),
+  RF("target_weight_kg", nullptr, 43, RF_U16, 1, "kg", target_weight),
+  // control values can be negative
+  RF("weight_control_kg", nullptr, 45, RF_I16, 1, "kg", weight_control),
+  RF("muscle_control_kg", nullptr, 47, RF_I16, 1, "kg", muscle_control),
+  RF("fat_control_kg", nullptr, 49, RF_I16, 1, "kg", fat_control),
+  RF("subcutaneous_fat_percent", nullptr, 51, RF_U16, 1, "%", subq_fat_percent),
+  RF("subq_std_min", nullptr, 53, RF_U16, 1, "%", subq_std_min),
+  RF("subq_std_max", nullptr, 55, RF_U16, 1, "%", subq_std_max),
+};
+
+// ===== PACKET 4 (0x54) - Energy consumption =====
+static constexpr ResultField ENERGY_FIELDS[] = {
+  RF("walk", nullptr, 5, RF_U16, 0, "kcal", walk),
+  RF("golf", nullptr, 7, RF_U16, 0, "kcal", golf),
+  RF("croquet", nullptr, 9, RF_U16, 0, "kcal", croquet),
+  RF("tennis_cycling_basketball", nullptr, 11, RF_U16, 0, "kcal", tennis_cycling_basketball),
+  RF("squash_tkd_fencing", nullptr, 13, RF_U16, 0, "kcal", squash_tkd_fencing),
+  RF("mountain_climbing", nullptr, 15, RF_U16, 0, "kcal", mountain_climbing),
+  RF("swimming_aerobic_jog", nullptr, 17, RF_U16, 0, "kcal", swimming_aerobic_jog),
+  RF("badminton_table_tennis", nullptr, 19, RF_U16, 0, "kcal", badminton_table_tennis),
+};
+
+// ===== PACKET 5 (0x55) - Standard classifications =====
+static constexpr ResultField STANDARD_FIELDS[] = {
+  RF_SEGMENTS("fat_standard", 5, RF_LEVEL, 0, "level", fat_standard),
+  RF_SEGMENTS("muscle_standard", 10, RF_LEVEL, 0, "level", muscle_standard),
+};
+
+#undef RF_SEGMENTS
+#undef RF
+
+// End of the last field (first byte after the data)
+template <size_t N>
+constexpr uint8_t schemaEnd(const ResultField (&fields)[N])
+{
+  uint8_t end = 0;
+  for (size_t i = 0; i < N; i++)
+  {
+    uint8_t e = fields[i].offset + resultFieldWidth(fields[i].type);
+    if (e > end)
+      end = e;
+  }
+  return end;
+}
+
+// Fields must stop at the checksum; packets 1-4 are fully described
+static_assert(schemaEnd(BODY_COMPOSITION_FIELDS) == RESULT_PACKET_LEN[0] - 1, "0x51 schema does not match length 0x50");
+static_assert(schemaEnd(SEGMENTAL_FIELDS) == RESULT_PACKET_LEN[1] - 1, "0x52 schema does not match length 0x2E");
+static_assert(schemaEnd(HEALTH_FIELDS) == RESULT_PACKET_LEN[2] - 1, "0x53 schema does not match length 0x3A");
+static_assert(schemaEnd(ENERGY_FIELDS) == RESULT_PACKET_LEN[3] - 1, "0x54 schema does not match length 0x16");
+static_assert(schemaEnd(STANDARD_FIELDS) <= RESULT_PACKET_LEN[4] - 1, "0x55 schema overruns length 0x16");
+
+// Bytes a table adds to the binary result
+template <size_t N>
+constexpr size_t schemaBinarySize(const ResultField (&fields)[N])
+{
+  size_t n = 0;
+  for (size_t i = 0; i < N; i++)
+  {
+    if (fields[i].type != RF_BODY_TYPE_NAME)
+      n += resultFieldWidth(fields[i].type);
+  }
+  return n;
+}
+
+static_assert(RESULT_BIN_HEADER + 2 * 5 * 4 + schemaBinarySize(BODY_COMPOSITION_FIELDS) +
+                      schemaBinarySize(SEGMENTAL_FIELDS) + schemaBinarySize(HEALTH_FIELDS) +
+                      schemaBinarySize(ENERGY_FIELDS) + schemaBinarySize(STANDARD_FIELDS) ==
+                  RESULT_BIN_MAX,
+              "binary result layout changed: update RESULT_BIN_MAX and RESULT_SCHEMA_VERSION");
+
+#define RESULT_PACKET(i, section, fields) \
+  { (uint8_t)(RESULT_FIRST_PACKAGE + (i)), RESULT_PACKET_LEN[i], section, fields, sizeof(fields) / sizeof(fields[0]) }
+
+const ResultPacketSchema RESULT_SCHEMA[RESULT_PACKET_COUNT] = {
+  RESULT_PACKET(0, "body_composition", BODY_COMPOSITION_FIELDS),
+  RESULT_PACKET(1, "segmental_analysis", SEGMENTAL_FIELDS),
+  RESULT_PACKET(2, "health_metrics", HEALTH_FIELDS),
+  RESULT_PACKET(3, "energy_consumption_kcal_per_30min", ENERGY_FIELDS),
+  RESULT_PACKET(4, "segmental_standards", STANDARD_FIELDS),
+};
+
+#undef RESULT_PACKET
+
+static int32_t readField(const uint8_t *p, const ResultField &f)
+{
+  switch (f.type)
+  {
+  case RF_U16:
+    return le_u16(&p[f.offset]);
+  case RF_I16:
+    return le_i16(&p[f.offset]);
+  default:
+    return p[f.offset];
+  }
+}
+
+void decodeResultPackets(const ResultPackets &packets, BodyCompositionResult &out)
+{
+  memset(&out, 0, sizeof(out));
+  for (uint8_t i = 0; i < RESULT_PACKET_COUNT; i++)
+  {
+    const ResultPacketSchema &s = RESULT_SCHEMA[i];
+    if (!packets.has(i))
+      continue;
+
+    const uint8_t *p = packets.packet(i);
+    uint8_t *base = (uint8_t *)&out;
+    for (uint8_t k = 0; k < s.count; k++)
+    {
+      int32_t v = readField(p, s.fields[k]);
+      memcpy(base + s.fields[k].dst, &v, sizeof(v));
+    }
+    out.decodedMask |= (uint8_t)(1u << i);
+  }
+}
+
+void decodeMeasurementResult(const ResultPackets &packets, const ImpedanceData &imp20k,
+                             const ImpedanceData &imp100k, MeasurementResult &out)
+{
+  out.errorCode = packets.error_type;
+  out.totalPackets = packets.total_packets;
+  out.receivedPackets = packets.received_count;
+  out.imp20k = imp20k;
+  out.imp100k = imp100k;
+  decodeResultPackets(packets, out.body);
+}
+
+int32_t resultValue(const BodyCompositionResult &r, const ResultField &f)
+{
+  int32_t v;
+  memcpy(&v, (const uint8_t *)&r + f.dst, sizeof(v));
+  return v;
+}
+
+static uint8_t *putLE(uint8_t *p, uint32_t v, uint8_t width)
+{
+  for (uint8_t i = 0; i < width; i++)
+    *p++ = (uint8_t)(v >> (8 * i));
+  return p;
+}
+
+static uint8_t *putImpedance(uint8_t *p, const ImpedanceData &imp)
+{
+  p = putLE(p, imp.rh, 4);
+  p = putLE(p, imp.lh, 4);
+  p = putLE(p, imp.trunk, 4);
+  p = putLE(p, imp.rf, 4);
+  return putLE(p, imp.lf, 4);
+}
+
+size_t encodeResultBinary(const MeasurementResult &r, uint8_t *out)
+{
+  uint8_t *p = out;
+  *p++ = RESULT_BIN_MARKER;
+  *p++ = RESULT_SCHEMA_VERSION;
+  *p++ = r.errorCode;
+  *p++ = r.errorCode ? 0 : r.body.decodedMask;
+  if (r.errorCode)
+    return p - out;
+
+  p = putImpedance(p, r.imp20k);
+  p = putImpedance(p, r.imp100k);
+
+  for (uint8_t i = 0; i < RESULT_PACKET_COUNT; i++)
+  {
+    if (!(r.body.decodedMask & (1u << i)))
+      continue;
+    const ResultPacketSchema &s = RESULT_SCHEMA[i];
+    for (uint8_t k = 0; k < s.count; k++)
+    {
+      const ResultField &f = s.fields[k];
+      if (f.type != RF_BODY_TYPE_NAME)
+        p = putLE(p, (uint32_t)resultValue(r.body, f), resultFieldWidth(f.type));
+    }
+  }
+  return p - out;
+}
@@ -0,0 +1,83 @@
+// ส่งผลการวัดไปยังปลายทางต่าง ๆ (Serial, BLE, ประวัติ)
+#include "result_sink.h"
+#include "ble_handler.h"
+#include "log.h"
+
+SerialResultSink serialResultSink;
+BleResultSink bleResultSink;
+ResultHistory resultHistory;
+
+static ResultSink *const SINKS[] = {&serialResultSink, &bleResultSink, &resultHistory};
+
+static void serialSink(void *ctx, const char *data, size_t len)
+{
+  logText(data, len);
+}
+
+// Printed by the log task, in order with the log lines around it
+void SerialResultSink::deliver(const MeasurementResult &r)
+{
+  static const char HEADER[] = "\n=== MEASUREMENT RESULTS ===\n";
+  static const char FOOTER[] = "\n=========================\n\n";
+  logText(HEADER, sizeof(HEADER) - 1);
+  char chunk[128];
+  JsonWriter w(chunk, sizeof(chunk), serialSink, nullptr);
+  writeResultJSON(w, r);
+  w.finish();
+  logText(FOOTER, sizeof(FOOTER) - 1);
+}
+
+void BleResultSink::deliver(const MeasurementResult &r)
+{
+  if (!bleHandler.isConnected())
+    return;
+
+  if (format == RESULT_FORMAT_BINARY)
+  {
+    uint8_t bin[RESULT_BIN_MAX];
+    size_t len = encodeResultBinary(r, bin);
+    if (bleHandler.sendBytes(bin, len))
+      LOG_INFO("Result sent via BLE: %u bytes binary (schema v%u)",
+               (unsigned)len, RESULT_SCHEMA_VERSION);
+    return;
+  }
+
+  // encode straight into the TX stream; the output loop notifies it piece
+  // by piece (the first one right away) without waiting on the link
+  size_t cap;
+  char *buf = bleHandler.txBuffer(cap);
+  if (!buf)
+    return;
+  JsonWriter w(buf, cap, RESULT_JSON_COMPACT);
+  writeResultJSON(w, r);
+  size_t total = w.finish();
+  if (w.overflowed())
+  {
+    LOG_WARN("Result JSON too long for BLE (%u bytes), not sent", (unsigned)total);
+    return;
+  }
+  bleHandler.txCommit(total);
+  LOG_INFO("Result sent via BLE: %u bytes, %u byte notifications",
+           (unsigned)total, (unsigned)bleHandler.notifyPayloadSize());
+}
+
+void ResultHistory::deliver(const MeasurementResult &r)
+{
+  entries[next] = r;
+  next = (next + 1) % RESULT_HISTORY_SIZE;
+  if (stored < RESULT_HISTORY_SIZE)
+    stored++;
+}
+
+const MeasurementResult *ResultHistory::get(size_t age) const
+{
+  if (age >= stored)
+    return nullptr;
+  return &entries[(next + RESULT_HISTORY_SIZE - 1 - age) % RESULT_HISTORY_SIZE];
+}
+
+void publishResult(const MeasurementResult &r)
+{
+  for (ResultSink *sink : SINKS)
+    sink->deliver(r);
+}
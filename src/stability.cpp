@@ -0,0 +1,406 @@
+// ตรวจจับน้ำหนักนิ่ง
+#include "stability.h"
+#include "log.h"
+
+static ConsecutiveStability consecutiveDetector;
+static WindowStability windowDetector;
+static PredictiveStability predictiveDetector;
+
+static StabilityDetector *const DETECTORS[STABILITY_MODE_COUNT] = {&consecutiveDetector, &windowDetector, &predictiveDetector};
+static const StabilityMode ACTIVE = WEIGHT_STABILITY_MODE;
+
+static StabilityReport report;
+static bool activeLocked = false;
+static bool sessionOpen = false; // report not printed yet
+
+void ConsecutiveStability::reset()
+{
+  hasAnchor = false;
+  count = 0;
+}
+
+bool ConsecutiveStability::addSample(long v)
+{
+  last = v;
+  if (!hasAnchor)
+  {
+    hasAnchor = true;
+    anchor = v;
+    count = 0;
+  }
+  else if (labs(v - anchor) <= STABLE_WEIGHT_DELTA)
+  {
+    count++;
+  }
+  else
+  {
+    count = 0;
+    anchor = v;
+  }
+  return count >= STABLE_REQUIRED_CNT;
+}
+
+uint8_t ConsecutiveStability::confidence() const
+{
+  return (count >= STABLE_REQUIRED_CNT) ? 100 : (uint8_t)(count * 100 / STABLE_REQUIRED_CNT);
+}
+
+void WindowStability::reset()
+{
+  head = 0;
+  count = 0;
+  sum = sumSq = 0;
+  sumOld = sumNew = 0;
+  conf = 0;
+}
+
+bool WindowStability::addSample(long v)
+{
+  if (count < STABILITY_WINDOW_SIZE)
+  {
+    samples[count++] = v;
+    sum += v;
+    sumSq += (long long)v * v;
+    if (count < STABILITY_WINDOW_SIZE)
+      return false;
+
+    for (uint8_t i = 0; i < HALF; i++)
+    {
+      sumOld += samples[i];
+      sumNew += samples[HALF + i];
+    }
+  }
+  else
+  {
+    // oldest leaves, the middle sample moves from the newer to the older half
+    long out = samples[head];
+    long mid = samples[(head + HALF) % STABILITY_WINDOW_SIZE];
+    samples[head] = v;
+    head = (head + 1) % STABILITY_WINDOW_SIZE;
+
+    sum += v - out;
+    sumSq += (long long)v * v - (long long)out * out;
+    sumOld += mid - out;
+    sumNew += v - mid;
+  }
+
+  // z * stddev <= delta  <=>  z^2 * (N*sumSq - sum^2) <= delta^2 * N^2
+  const long long n = STABILITY_WINDOW_SIZE;
+  long long spread = n * sumSq - sum * sum;
+  long long band = (long long)STABILITY_TOLERANCE * STABILITY_TOLERANCE * n * n;
+  float zSpread = STABILITY_CONFIDENCE_Z * STABILITY_CONFIDENCE_Z * (float)spread;
+  bool tight = zSpread <= (float)band;
+  bool flat = labs(sumNew - sumOld) <= STABILITY_TREND_MAX * HALF;
+  // full confidence when stable, otherwise how close the spread is to the band
+  conf = (tight && flat) ? 100 : (uint8_t)(99.0f * (tight ? 1.0f : sqrtf((float)band / zSpread)));
+  return tight && flat;
+}
+
+long WindowStability::value() const
+{
+  if (count == 0)
+    return 0;
+  long long s = (sum >= 0) ? sum + count / 2 : sum - count / 2;
+  return (long)(s / count);
+}
+
+void PredictiveStability::reset()
+{
+  hasSample = false;
+  s1 = sx = sy = sxx = sxy = 0;
+  samples = 0;
+  predicted = false;
+  mean = drift = 0;
+  agree = 0;
+}
+
+bool PredictiveStability::addSample(long v)
+{
+  if (!hasSample)
+  {
+    hasSample = true;
+    base = v;
+    prev = 0;
+    return false;
+  }
+
+  float y = (float)(v - base);
+  float x = prev;
+  prev = y;
+  s1 = s1 * PREDICT_FORGET + 1.0f;
+  sx = sx * PREDICT_FORGET + x;
+  sy = sy * PREDICT_FORGET + y;
+  sxx = sxx * PREDICT_FORGET + x * x;
+  sxy = sxy * PREDICT_FORGET + x * y;
+  if (++samples < PREDICT_MIN_SAMPLES)
+    return false;
+
+  float den = s1 * sxx - sx * sx;
+  if (den <= 0.0f)
+    return false;
+  float r = (s1 * sxy - sx * sy) / den;
+  if (r >= PREDICT_RATIO_MAX)
+  {
+    agree = 0; // too slow (or growing) to extrapolate
+    return false;
+  }
+  float c = (sy - r * sx) / s1;
+  float w = c / (1.0f - r);
+  if (fabsf(w - y) > PREDICT_MAX_JUMP)
+  {
+    agree = 0;
+    return false;
+  }
+
+  if (!predicted)
+  {
+    predicted = true;
+    mean = w;
+    drift = PREDICT_TOLERANCE;
+  }
+  else
+  {
+    mean += (w - mean) * 0.5f;
+  }
+  float dev = fabsf(w - mean);
+  drift += (dev - drift) * 0.25f;
+
+  if (dev <= PREDICT_TOLERANCE)
+  {
+    if (agree < 255)
+      agree++;
+  }
+  else
+    agree = 0;
+  return agree >= PREDICT_CONFIRM;
+}
+
+long PredictiveStability::value() const
+{
+  return base + lroundf(predicted ? mean : prev);
+}
+
+uint8_t PredictiveStability::confidence() const
+{
+  if (!predicted)
+    return 0;
+  // recent prediction drift against the tolerance, scaled by agreement
+  float c = 1.0f - drift / (2.0f * PREDICT_TOLERANCE);
+  if (c < 0.0f)
+    c = 0.0f;
+  uint8_t a = (agree < PREDICT_CONFIRM) ? agree : PREDICT_CONFIRM;
+  return (uint8_t)(100.0f * c * a / PREDICT_CONFIRM);
+}
+
+void ImpedanceStability::reset()
+{
+  memset(sum, 0, sizeof(sum));
+  memset(sumSq, 0, sizeof(sumSq));
+  memset(sumOld, 0, sizeof(sumOld));
+  memset(sumNew, 0, sizeof(sumNew));
+  head = 0;
+  count = 0;
+  lockedMask = 0;
+  total = 0;
+}
+
+bool ImpedanceStability::addSample(const uint32_t (&v)[IMP_CHANNELS])
+{
+  total++;
+  if (count < IMP_WINDOW_SIZE)
+  {
+    uint32_t *row = window[count++];
+    for (uint8_t c = 0; c < IMP_CHANNELS; c++)
+    {
+      row[c] = v[c];
+      sum[c] += v[c];
+      sumSq[c] += (uint64_t)v[c] * v[c];
+    }
+    if (count < IMP_WINDOW_SIZE)
+      return false;
+
+    for (uint8_t i = 0; i < HALF; i++)
+      for (uint8_t c = 0; c < IMP_CHANNELS; c++)
+      {
+        sumOld[c] += window[i][c];
+        sumNew[c] += window[HALF + i][c];
+      }
+  }
+  else
+  {
+    // oldest row leaves, the middle row moves from the newer to the older half
+    uint32_t *out = window[head];
+    const uint32_t *mid = window[(head + HALF) % IMP_WINDOW_SIZE];
+    for (uint8_t c = 0; c < IMP_CHANNELS; c++)
+    {
+      sum[c] += v[c] - out[c];
+      sumSq[c] += (uint64_t)v[c] * v[c] - (uint64_t)out[c] * out[c];
+      sumOld[c] += mid[c] - out[c];
+      sumNew[c] += v[c] - mid[c];
+      out[c] = v[c];
+    }
+    head = (head + 1) % IMP_WINDOW_SIZE;
+  }
+
+  // Same test as WindowStability, scaled by N: tol*N is relative to the lane sum
+  const uint64_t n = IMP_WINDOW_SIZE;
+  for (uint8_t c = 0; c < IMP_CHANNELS; c++)
+  {
+    if (lockedMask & (1 << c))
+      continue;
+    float tolN = (float)sum[c] * (IMP_TOLERANCE_PPM / 1000000.0f);
+    if (tolN < (float)(IMP_TOLERANCE_FLOOR * n))
+      tolN = (float)(IMP_TOLERANCE_FLOOR * n);
+    float spread = (float)(n * sumSq[c] - (uint64_t)sum[c] * sum[c]);
+    bool tight = IMP_CONFIDENCE_Z * IMP_CONFIDENCE_Z * spread <= tolN * tolN;
+    long drift = labs((long)sumNew[c] - (long)sumOld[c]);
+    bool flat = (float)drift * 2.0f <= tolN;
+    if (tight && flat)
+    {
+      lockedMask |= (1 << c);
+      value[c] = (sum[c] + IMP_WINDOW_SIZE / 2) / IMP_WINDOW_SIZE;
+      lockAt[c] = total;
+    }
+  }
+  return locked();
+}
+
+void ImpedanceStability::result(ImpedanceData &out) const
+{
+  out.rh = value[IMP_RH];
+  out.lh = value[IMP_LH];
+  out.trunk = value[IMP_TRUNK];
+  out.rf = value[IMP_RF];
+  out.lf = value[IMP_LF];
+}
+
+void ImpedanceStability::printStatus() const
+{
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  static const char *const NAMES[IMP_CHANNELS] = {"RH", "LH", "TR", "RF", "LF"};
+  char line[LOG_STR_MAX];
+  size_t n = 0;
+  line[0] = '\0';
+  for (uint8_t c = 0; c < IMP_CHANNELS && n < sizeof(line); c++)
+  {
+    if (lockedMask & (1 << c))
+      n += snprintf(line + n, sizeof(line) - n, " %s@%u", NAMES[c], lockAt[c]);
+    else
+      n += snprintf(line + n, sizeof(line) - n, " %s-", NAMES[c]);
+  }
+  LOG_DEBUG("Imp sample %u locked:%s", total, line);
+#endif
+}
+
+void weightStabilityBegin()
+{
+  for (StabilityDetector *d : DETECTORS)
+    d->reset();
+  memset(&report, 0, sizeof(report));
+  report.startMs = millis();
+  activeLocked = false;
+  sessionOpen = true;
+}
+
+// Every detector gets every sample until the user steps off, so the
+// report also shows the ones slower than the active detector
+static unsigned long feedDetectors(long value)
+{
+  unsigned long elapsed = millis() - report.startMs;
+  if (elapsed == 0)
+    elapsed = 1; // 0 means "never locked"
+
+  for (uint8_t m = 0; m < STABILITY_MODE_COUNT; m++)
+  {
+    if (DETECTORS[m]->addSample(value) && report.lockMs[m] == 0)
+    {
+      report.lockMs[m] = elapsed;
+      report.lockValue[m] = DETECTORS[m]->value();
+      report.lockConfidence[m] = DETECTORS[m]->confidence();
+      report.afterMeasurement[m] = activeLocked;
+    }
+  }
+  return elapsed;
+}
+
+bool weightStabilityAdd(long value, long &locked)
+{
+  unsigned long elapsed = feedDetectors(value);
+  if (activeLocked)
+    return false;
+
+  if (report.lockMs[ACTIVE] == 0 && elapsed >= STABILITY_MAX_LOCK_MS)
+  {
+    // never settled (fidgeting user): take the best estimate we have
+    report.forced = true;
+    report.lockMs[ACTIVE] = elapsed;
+    report.lockValue[ACTIVE] = DETECTORS[ACTIVE]->value();
+    report.lockConfidence[ACTIVE] = DETECTORS[ACTIVE]->confidence();
+  }
+
+  if (report.lockMs[ACTIVE] == 0)
+    return false;
+
+  activeLocked = true;
+  locked = report.lockValue[ACTIVE];
+  return true;
+}
+
+int weightStabilityProgress()
+{
+  return DETECTORS[ACTIVE]->progress();
+}
+
+uint8_t weightStabilityConfidence()
+{
+  return report.lockConfidence[ACTIVE];
+}
+
+void weightStabilityReference(long value)
+{
+  if (report.refCount < STABILITY_WINDOW_SIZE)
+  {
+    report.refSum += value;
+    report.refCount++;
+  }
+  if (activeLocked)
+    feedDetectors(value);
+}
+
+const StabilityReport &stabilityReport()
+{
+  return report;
+}
+
+void printStabilityReport()
+{
+  if (!sessionOpen)
+    return;
+  sessionOpen = false;
+
+  bool hasRef = report.refCount > 0;
+  float ref = hasRef ? report.refSum / (float)report.refCount : 0.0f;
+  if (hasRef)
+    LOG_INFO("Stability: settled reference %.2f kg (%u samples)", ref / 1000.0f, report.refCount);
+  else
+    LOG_INFO("Stability: no settled reference (stepped off early)");
+
+  for (uint8_t m = 0; m < STABILITY_MODE_COUNT; m++)
+  {
+    const char *tag = (m == ACTIVE)                ? (report.forced ? " [active, forced]" : " [active]")
+                      : report.afterMeasurement[m] ? " [after measurement]"
+                                                   : "";
+    if (report.lockMs[m] == 0)
+    {
+      LOG_INFO("  %-12s not locked%s", DETECTORS[m]->name(), tag);
+      continue;
+    }
+    if (hasRef)
+      LOG_INFO("  %-12s lock %lu ms, %.1f kg (conf %u%%), error %+.2f kg%s", DETECTORS[m]->name(),
+               report.lockMs[m], report.lockValue[m] / 1000.0f, report.lockConfidence[m],
+               (report.lockValue[m] - ref) / 1000.0f, tag);
+    else
+      LOG_INFO("  %-12s lock %lu ms, %.1f kg (conf %u%%)%s", DETECTORS[m]->name(),
+               report.lockMs[m], report.lockValue[m] / 1000.0f, report.lockConfidence[m], tag);
+  }
+}
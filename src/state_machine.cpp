@@ -3,297 +3,615 @@
 #include "protocol.h"
 #include "config.h"
 #include "ble_handler.h"
+#include "buffer.h"
+#include "uart_rx.h"
+#include "transaction.h"
+#include "tx_queue.h"
+#include "poll_scheduler.h"
+#include "result_schema.h"
+#include "auto_zero.h"
+#include "live_telemetry.h"
+#include "app_tasks.h"
+#include "timers.h"
+#include "kiosk.h"
+#include "log.h"
 #include <ArduinoJson.h>
 
-void initStateMachine(StateMachineContext &ctx) {
-  ctx.currentState = WAIT_JSON;
-  ctx.lastPollSendMs = 0;
-  ctx.ack_A0_received = false;
-  ctx.ack_B0_received = false;
-  ctx.ack_B0_2_received = false;
-  ctx.userInfo.valid = false;
-  initMeasurementData(ctx.mData);
+static void dispatch(StateMachineContext &ctx, FsmEvent ev);
+
+static StateTiming timings[STATE_COUNT];
+
+static void printFrameStats() {
+  const FrameStats &fs = frameStats();
+  RxOverflowStats ovf = rxOverflowStats();
+  LOG_INFO("Frames: ok=%lu lost=%lu (checksum=%lu length=%lu overflow=%lu) dropped bytes=%lu",
+           (unsigned long)fs.framesOk, (unsigned long)fs.framesLost(),
+           (unsigned long)fs.checksumErrors, (unsigned long)fs.lengthErrors,
+           (unsigned long)fs.overflowErrors, (unsigned long)fs.bytesDropped);
+  LOG_INFO("RX overflows: %lu (%lu bytes since boot)",
+           (unsigned long)ovf.events, (unsigned long)ovf.bytes);
+  const TxQueueStats &tx = txQueueStats();
+  LOG_INFO("TX queue: sent=%lu dropped=%lu, FIFO wait avg=%luus max=%luus (since boot)",
+           (unsigned long)tx.sent, (unsigned long)tx.dropped,
+           (unsigned long)tx.avgWaitUs(), (unsigned long)tx.maxWaitUs);
+  const RxLatencyStats &lat = rxLatencyStats();
+  if (lat.count > 0)
+  {
+    LOG_INFO("RX latency: avg=%luus min=%luus max=%luus (%lu frames)",
+             (unsigned long)lat.avgUs(), (unsigned long)lat.minUs,
+             (unsigned long)lat.maxUs, (unsigned long)lat.count);
+  }
 }
 
-void handleJsonInput(const String &jsonStr, StateMachineContext &ctx) {
-  StaticJsonDocument<256> doc;
-  DeserializationError err = deserializeJson(doc, jsonStr);
-  if (err)
+void printStateTimings() {
+  for (uint8_t s = 0; s < STATE_COUNT; s++)
   {
-    Serial.print("JSON parse error: ");
-    Serial.println(err.c_str());
-    return;
+    const StateTiming &t = timings[s];
+    if (t.entries == 0)
+      continue;
+    LOG_INFO("State %-20s n=%lu total=%lums max=%lums", stateName((State)s),
+             (unsigned long)t.entries, (unsigned long)t.totalMs, (unsigned long)t.maxMs);
   }
+}
 
-  if (doc.containsKey("gender"))
-    ctx.userInfo.gender = (uint8_t)doc["gender"].as<int>();
-  if (doc.containsKey("product_id"))
-    ctx.userInfo.product_id = (uint8_t)doc["product_id"].as<int>();
-  if (doc.containsKey("height"))
-    ctx.userInfo.height = (uint16_t)doc["height"].as<int>();
-  if (doc.containsKey("age"))
-    ctx.userInfo.age = (uint8_t)doc["age"].as<int>();
-  ctx.userInfo.valid = true;
-  
-  Serial.println("User JSON accepted:");
-  Serial.printf(" gender=%u product_id=%u height=%u age=%u\n", 
-                ctx.userInfo.gender, ctx.userInfo.product_id, 
-                ctx.userInfo.height, ctx.userInfo.age);
-  
-  ctx.currentState = SEND_A0_WAIT_ACK;
-  resetMeasurementData(ctx.mData);
-  ctx.lastPollSendMs = 0;
-  ctx.ack_A0_received = false;
-  ctx.ack_B0_received = false;
-  ctx.ack_B0_2_received = false;
+// Report a session that is given up: log, stats, kiosk run, app error
+static void reportAbort(const char *reason) {
+  LOG_WARN("\n*** Session aborted: %s ***", reason);
+  printFrameStats();
+  printTxnStats();
+  printStateTimings();
+  printTimerStats();
+  kioskSessionEnd(false);
+
+  if (bleHandler.isConnected())
+  {
+    StaticJsonDocument<128> doc;
+    doc["type"] = "error";
+    doc["message"] = reason;
+
+    String jsonString;
+    serializeJson(doc, jsonString);
+    postBleJson(jsonString);
+  }
 }
 
-void processStateMachine(StateMachineContext &ctx) {
-  unsigned long now = millis();
+// Give up on the current session (device not answering) and go back to idle
+static void abortSession(StateMachineContext &ctx, const char *reason) {
+  reportAbort(reason);
+  dispatch(ctx, EV_FAILED);
+}
+
+// ---- Entry / exit actions. An entry action may return the event that
+// completes its state at once (e.g. tare skipped), EV_NONE otherwise. ----
 
-  switch (ctx.currentState)
+static FsmEvent enterWaitJson(StateMachineContext &ctx) {
+  txnReset();
+  resetMeasurementData(ctx.mData);
+  ctx.userInfo.valid = false;
+  LOG_INFO("=== Ready for next measurement ===");
+  LOG_INFO("Paste JSON to start new measurement...");
+  return EV_NONE;
+}
+
+static FsmEvent enterSendA0(StateMachineContext &ctx) {
+  // new session; a restart abandons a queued session still running
+  kioskSessionEnd(false);
+  if (!ctx.userInfo.valid && kioskTake(ctx.userInfo))
   {
-  case WAIT_JSON:
-    break;
+    LOG_INFO("Kiosk session: gender=%u height=%u age=%u (%u more queued)",
+             ctx.userInfo.gender, ctx.userInfo.height, ctx.userInfo.age, kioskPending());
+  }
+  resetMeasurementData(ctx.mData);
+  txnReset();
+  resetTxnStats();
+  resetFrameStats();
+  resetRxLatencyStats();
+  resetLiveStats();
+  resetTimerStats();
+  memset(timings, 0, sizeof(timings));
+
+  txnBegin(TXN_A0);
+  LOG_INFO("Sending A0 (handshake)...");
+  return EV_NONE;
+}
 
-  case SEND_A0_WAIT_ACK:
+static FsmEvent enterTare(StateMachineContext &ctx) {
+  if (autoZeroFresh())
   {
-    static bool sent = false;
-    if (!sent)
-    {
-      Serial.println("Sending A0 (handshake)...");
-      send_cmd_A0();
-      sent = true;
-      ctx.ack_A0_received = false;
-    }
-    if (ctx.ack_A0_received)
-    {
-      Serial.println("=== Transitioning to TARE_WEIGHT state ===");
-      Serial.println("Please ensure the scale is empty for tare calibration...");
-      sent = false;
-      ctx.currentState = TARE_WEIGHT;
-      ctx.mData.tare_completed = false;
-      ctx.mData.tare_sample_count = 0;
-      ctx.mData.tare_sum = 0;
-      ctx.lastPollSendMs = millis() - POLL_INTERVAL_MS;
-    }
-    break;
+    ctx.mData.tare_offset = autoZeroOffset();
+    ctx.mData.tare_completed = true;
+    LOG_INFO(">>> Tare skipped, tracked zero = %ld ADC units", ctx.mData.tare_offset);
+    return EV_TARE_DONE;
   }
+  ctx.mData.tare_completed = false;
+  ctx.mData.tare_sample_count = 0;
+  ctx.mData.tare_sum = 0;
+  LOG_INFO("Please ensure the scale is empty for tare calibration...");
+  return EV_NONE;
+}
 
-  case TARE_WEIGHT:
+static FsmEvent enterWaitForWeight(StateMachineContext &ctx) {
+  LOG_INFO("Please step on the scale (waiting for weight > %.1f kg)...", MIN_WEIGHT_TO_START);
+  return EV_NONE;
+}
+
+static FsmEvent enterWeighing(StateMachineContext &ctx) {
+  weightStabilityBegin();
+  LOG_INFO("Now measuring weight, please stay still...");
+  return EV_NONE;
+}
+
+static FsmEvent enterSendB0(StateMachineContext &ctx) {
+  LOG_INFO("Weight stabilized. Proceeding to B0 start.");
+
+  // Send weight finalized and impedance measurement starting notification via BLE
+  if (bleHandler.isConnected())
   {
-    if (now - ctx.lastPollSendMs >= WEIGHT_POLL_INTERVAL_MS)
-    {
-      ctx.lastPollSendMs = now;
-      Serial.println("Sending A1 for tare reading...");
-      send_cmd_A1();
-    }
+    StaticJsonDocument<256> doc;
+    doc["type"] = "weight_finalized";
+    doc["weight"] = (float)ctx.mData.weight_final / 1000.0;
+    doc["confidence"] = ctx.mData.weight_confidence / 100.0;
+    doc["status"] = "starting_impedance_measurement";
 
-    if (ctx.mData.tare_completed)
-    {
-      ctx.mData.tare_offset = ctx.mData.tare_sum / TARE_SAMPLES;
-      Serial.printf(">>> Tare completed! Offset = %ld ADC units\n", ctx.mData.tare_offset);
-      Serial.println("=== Transitioning to WAIT_FOR_WEIGHT state ===");
-      Serial.printf("Please step on the scale (waiting for weight > %.1f kg)...\n", MIN_WEIGHT_TO_START);
-      ctx.currentState = WAIT_FOR_WEIGHT;
-      ctx.lastPollSendMs = millis() - POLL_INTERVAL_MS;
-    }
-    break;
+    String jsonString;
+    serializeJson(doc, jsonString);
+    postBleJson(jsonString);
+    LOG_INFO("Sent weight finalized and starting impedance measurement via BLE");
   }
 
-  case WAIT_FOR_WEIGHT:
+  txnBegin(TXN_B0_20K);
+  LOG_INFO("Sending B0 (mode start) 03...");
+  return EV_NONE;
+}
+
+static FsmEvent enterImpedance(StateMachineContext &ctx) {
+  ctx.mData.impStability.reset();
+  ctx.mData.impedance_final_valid = false;
+  return EV_NONE;
+}
+
+static FsmEvent enterSendB0Second(StateMachineContext &ctx) {
+  ctx.mData.imp_20k = ctx.mData.imp_final;
+  LOG_INFO("Impedance first-round stabilized. Sending B0 second-phase.");
+  txnBegin(TXN_B0_100K);
+  LOG_INFO("Sending B0 second phase (01 06) ...");
+  return EV_NONE;
+}
+
+static FsmEvent enterBuildFinal(StateMachineContext &ctx) {
+  ctx.mData.imp_100k = ctx.mData.imp_final;
+  LOG_INFO("Impedance stabilized second round. Building final packet.");
+  if (!buildAndSendFinalPacket(ctx.userInfo, ctx.mData))
   {
-    if (now - ctx.lastPollSendMs >= WEIGHT_POLL_INTERVAL_MS)
-    {
-      ctx.lastPollSendMs = now;
-      send_cmd_A1();
-    }
-    break;
+    // nothing in flight: abort now instead of waiting out RESULT_WAIT_MS
+    reportAbort("final packet not built");
+    return EV_FAILED;
   }
+  ctx.mData.resultPackets.reset();
+  return EV_D0_SENT;
+}
 
-  case SEND_A1_LOOP:
-  {
-    if (now - ctx.lastPollSendMs >= WEIGHT_POLL_INTERVAL_MS)
-    {
-      ctx.lastPollSendMs = now;
-      send_cmd_A1();
-    }
+static FsmEvent enterWaitResults(StateMachineContext &ctx) {
+  LOG_INFO("\n*** D0 packet sent! ***");
+  LOG_INFO("Waiting for calculation results (%u packets)...", RESULT_PACKET_COUNT);
+  return EV_NONE;
+}
 
-    if (ctx.mData.weight_final_valid)
-    {
-      Serial.println("Weight stabilized. Proceeding to B0 start.");
-      
-      // Send weight finalized and impedance measurement starting notification via BLE
-      if (bleHandler.isConnected())
-      {
-        StaticJsonDocument<256> doc;
-        doc["type"] = "weight_finalized";
-        doc["weight"] = (float)ctx.mData.weight_final / 10.0;
-        doc["status"] = "starting_impedance_measurement";
-        
-        String jsonString;
-        serializeJson(doc, jsonString);
-        bleHandler.sendData(jsonString);
-        Serial.println("Sent weight finalized and starting impedance measurement via BLE");
-      }
-      
-      ctx.currentState = SEND_B0_WAIT_ACK;
-    }
-    break;
+static FsmEvent enterDone(StateMachineContext &ctx) {
+  if (ctx.mData.resultPackets.isComplete())
+  {
+    LOG_INFO("\n*** All result packets received! ***");
+    // Decode once, then Serial / BLE / history render the same result
+    MeasurementResult result;
+    decodeMeasurementResult(ctx.mData.resultPackets, ctx.mData.imp_20k, ctx.mData.imp_100k, result);
+    // rendered and sent by the output side
+    postResult(result, ctx.userInfo.result_format);
   }
+  else
+  {
+    // D0 never answered, or RESULT_WAIT_MS elapsed
+    LOG_WARN("\n*** Timeout waiting for result packets! ***");
+    LOG_WARN("Received only %d/%d packets",
+             ctx.mData.resultPackets.received_count,
+             ctx.mData.resultPackets.total_packets);
+  }
+  printFrameStats();
+  printTxnStats();
+  printStateTimings();
+  printTimerStats();
+  if (kioskActive())
+  {
+    kioskSessionEnd(ctx.mData.resultPackets.isComplete());
+    kioskReport();
+  }
+  LOG_INFO("Please step off the scale...");
+  return EV_NONE;
+}
+
+static void exitWaitScaleEmpty(StateMachineContext &ctx) {
+  printStabilityReport();
+  const LiveStats &live = liveStats();
+  LOG_INFO("Live telemetry: %lu readings, %lu sent, %lu coalesced",
+           (unsigned long)live.offered, (unsigned long)live.sent,
+           (unsigned long)live.coalesced);
+  printTaskStats();
+}
+
+// ---- Tables ----
+
+typedef FsmEvent (*StateEntry)(StateMachineContext &ctx);
+typedef void (*StateExit)(StateMachineContext &ctx);
+
+// What processStateMachine() does in a state
+enum PollMode : uint8_t
+{
+  POLL_NONE, // nothing (the state timer, if any, runs on its own)
+  POLL_IDLE, // slow A1 poll for auto-zero (TIMER_IDLE_POLL)
+  POLL_ACK,  // waits for txn, EV_ACK when it is answered
+  POLL_LOOP, // txn polled through pollService()
+  POLL_WAIT  // txn outstanding; its failure raises EV_TIMEOUT
+};
+
+struct StateSpec
+{
+  State state;
+  const char *name;
+  PollMode poll;
+  TxnCommand txn;
+  uint16_t timeoutMs;     // EV_TIMEOUT after this long in the state (0: none)
+  const char *failReason; // ACK / polls failing abort the session with this
+  StateEntry onEntry;
+  StateExit onExit;
+};
+
+static constexpr StateSpec STATE_SPECS[STATE_COUNT] = {
+    {WAIT_JSON, "WAIT_JSON", POLL_IDLE, TXN_A1, 0, nullptr, enterWaitJson, nullptr},
+    {SEND_A0_WAIT_ACK, "SEND_A0_WAIT_ACK", POLL_ACK, TXN_A0, 0, "no A0 handshake ACK", enterSendA0, nullptr},
+    {TARE_WEIGHT, "TARE_WEIGHT", POLL_LOOP, TXN_A1, 0, "no answer to A1 (weight)", enterTare, nullptr},
+    {WAIT_FOR_WEIGHT, "WAIT_FOR_WEIGHT", POLL_LOOP, TXN_A1, 0, "no answer to A1 (weight)", enterWaitForWeight, nullptr},
+    {SEND_A1_LOOP, "SEND_A1_LOOP", POLL_LOOP, TXN_A1, 0, "no answer to A1 (weight)", enterWeighing, nullptr},
+    {SEND_B0_WAIT_ACK, "SEND_B0_WAIT_ACK", POLL_ACK, TXN_B0_20K, 0, "no B0 (03) ACK", enterSendB0, nullptr},
+    {SEND_B1_LOOP, "SEND_B1_LOOP", POLL_LOOP, TXN_B1, 0, "no answer to B1 (impedance)", enterImpedance, nullptr},
+    {SEND_B0_2_WAIT_ACK, "SEND_B0_2_WAIT_ACK", POLL_ACK, TXN_B0_100K, 0, "no B0 (06) ACK", enterSendB0Second, nullptr},
+    {SEND_B1_LOOP2, "SEND_B1_LOOP2", POLL_LOOP, TXN_B1, 0, "no answer to B1 (impedance)", enterImpedance, nullptr},
+    {BUILD_AND_SEND_FINAL, "BUILD_AND_SEND_FINAL", POLL_NONE, TXN_COUNT, 0, nullptr, enterBuildFinal, nullptr},
+    {WAIT_RESULT_PACKETS, "WAIT_RESULT_PACKETS", POLL_WAIT, TXN_D0, RESULT_WAIT_MS, nullptr, enterWaitResults, nullptr},
+    {DONE, "DONE", POLL_NONE, TXN_COUNT, DONE_HOLD_MS, nullptr, enterDone, nullptr},
+    {WAIT_SCALE_EMPTY, "WAIT_SCALE_EMPTY", POLL_LOOP, TXN_A1, 0, "no answer to A1 (weight)", nullptr, exitWaitScaleEmpty},
+};
 
-  case SEND_B0_WAIT_ACK:
+static const char *const EVENT_NAMES[EV_COUNT] = {
+    "NONE", "START", "ACK", "TARE_DONE", "WEIGHT_ON", "WEIGHT_LOCKED",
+    "IMP_LOCKED", "D0_SENT", "RESULTS", "SCALE_EMPTY", "STEP_ON", "TIMEOUT", "FAILED"};
+
+struct Transition
+{
+  State from; // ANY_STATE: every state without a row of its own for this event
+  FsmEvent event;
+  State to;
+};
+
+static constexpr State ANY_STATE = STATE_COUNT;
+
+static constexpr Transition TRANSITIONS[] = {
+    // new user info restarts the session from any state; failures abort it
+    {ANY_STATE, EV_START, SEND_A0_WAIT_ACK},
+    {ANY_STATE, EV_FAILED, WAIT_JSON},
+    {WAIT_JSON, EV_START, SEND_A0_WAIT_ACK},
+    {WAIT_JSON, EV_STEP_ON, SEND_A0_WAIT_ACK}, // kiosk: next queued profile
+    {SEND_A0_WAIT_ACK, EV_ACK, TARE_WEIGHT},
+    {TARE_WEIGHT, EV_TARE_DONE, WAIT_FOR_WEIGHT},
+    {WAIT_FOR_WEIGHT, EV_WEIGHT_ON, SEND_A1_LOOP},
+    {SEND_A1_LOOP, EV_WEIGHT_LOCKED, SEND_B0_WAIT_ACK},
+    {SEND_B0_WAIT_ACK, EV_ACK, SEND_B1_LOOP},
+    {SEND_B1_LOOP, EV_IMP_LOCKED, SEND_B0_2_WAIT_ACK},
+    {SEND_B0_2_WAIT_ACK, EV_ACK, SEND_B1_LOOP2},
+    {SEND_B1_LOOP2, EV_IMP_LOCKED, BUILD_AND_SEND_FINAL},
+    {BUILD_AND_SEND_FINAL, EV_D0_SENT, WAIT_RESULT_PACKETS},
+    {WAIT_RESULT_PACKETS, EV_RESULTS, DONE},
+    {WAIT_RESULT_PACKETS, EV_TIMEOUT, DONE},
+    {DONE, EV_TIMEOUT, WAIT_SCALE_EMPTY},
+    {WAIT_SCALE_EMPTY, EV_SCALE_EMPTY, WAIT_JSON},
+};
+
+static constexpr size_t TRANSITION_COUNT = sizeof(TRANSITIONS) / sizeof(TRANSITIONS[0]);
+
+// ---- Table checks ----
+
+static constexpr bool specsInStateOrder() {
+  for (uint8_t s = 0; s < STATE_COUNT; s++)
+    if (STATE_SPECS[s].state != s)
+      return false;
+  return true;
+}
+
+static constexpr bool transitionsInRange() {
+  for (size_t i = 0; i < TRANSITION_COUNT; i++)
   {
-    static bool sent = false;
-    if (!sent)
-    {
-      Serial.println("Sending B0 (mode start) 03...");
-      send_cmd_B0_len6_0303();
-      sent = true;
-      ctx.ack_B0_received = false;
-    }
-    if (ctx.ack_B0_received)
-    {
-      Serial.println("=== Transitioning to SEND_B1_LOOP state ===");
-      sent = false;
-      ctx.currentState = SEND_B1_LOOP;
-      ctx.lastPollSendMs = millis() - POLL_INTERVAL_MS;
-    }
-    break;
+    const Transition &t = TRANSITIONS[i];
+    if (t.from > ANY_STATE || t.to >= STATE_COUNT || t.event == EV_NONE || t.event >= EV_COUNT)
+      return false;
   }
+  return true;
+}
+
+static constexpr bool noDuplicateTransitions() {
+  for (size_t i = 0; i < TRANSITION_COUNT; i++)
+    for (size_t j = i + 1; j < TRANSITION_COUNT; j++)
+      if (TRANSITIONS[i].from == TRANSITIONS[j].from && TRANSITIONS[i].event == TRANSITIONS[j].event)
+        return false;
+  return true;
+}
+
+static constexpr bool hasRow(State from, FsmEvent ev) {
+  for (size_t i = 0; i < TRANSITION_COUNT; i++)
+    if (TRANSITIONS[i].from == from && TRANSITIONS[i].event == ev)
+      return true;
+  return false;
+}
 
-  case SEND_B1_LOOP:
+// Every state is entered by some row and left by a row of its own
+static constexpr bool everyStateConnected() {
+  for (uint8_t s = 0; s < STATE_COUNT; s++)
   {
-    if (now - ctx.lastPollSendMs >= POLL_INTERVAL_MS)
-    {
-      ctx.lastPollSendMs = now;
-      Serial.println("Sending B1 (impedance read)...");
-      send_cmd_B1();
-    }
-    if (ctx.mData.impedance_final_valid)
+    bool entered = false, left = false;
+    for (size_t i = 0; i < TRANSITION_COUNT; i++)
     {
-      ctx.mData.imp_20k.rh = ctx.mData.imp_right_hand;
-      ctx.mData.imp_20k.lh = ctx.mData.imp_left_hand;
-      ctx.mData.imp_20k.trunk = ctx.mData.imp_trunk;
-      ctx.mData.imp_20k.rf = ctx.mData.imp_right_foot;
-      ctx.mData.imp_20k.lf = ctx.mData.imp_left_foot;
-      Serial.println("Impedance first-round stabilized. Sending B0 second-phase.");
-      ctx.currentState = SEND_B0_2_WAIT_ACK;
+      entered = entered || TRANSITIONS[i].to == s;
+      left = left || TRANSITIONS[i].from == s;
     }
-    break;
+    if (!entered || !left)
+      return false;
   }
+  return true;
+}
 
-  case SEND_B0_2_WAIT_ACK:
+// The tick only raises what the table handles: EV_ACK for POLL_ACK,
+// EV_TIMEOUT for timers and POLL_WAIT, EV_FAILED where a reason is set
+static constexpr bool tickEventsHandled() {
+  for (uint8_t s = 0; s < STATE_COUNT; s++)
   {
-    static bool sent = false;
-    if (!sent)
-    {
-      Serial.println("Sending B0 second phase (01 06) ...");
-      send_cmd_B0_len6_0106();
-      sent = true;
-      ctx.ack_B0_2_received = false;
-    }
-    if (ctx.ack_B0_2_received)
-    {
-      Serial.println("=== Transitioning to SEND_B1_LOOP2 state ===");
-      sent = false;
-      ctx.currentState = SEND_B1_LOOP2;
-      ctx.lastPollSendMs = millis() - POLL_INTERVAL_MS;
-      ctx.mData.impHasInitial = false;
-      ctx.mData.impStableCount = 0;
-      ctx.mData.impedance_final_valid = false;
-    }
-    break;
+    const StateSpec &spec = STATE_SPECS[s];
+    bool timer = spec.timeoutMs != 0 || spec.poll == POLL_WAIT;
+    if (timer != hasRow((State)s, EV_TIMEOUT))
+      return false;
+    if ((spec.poll == POLL_ACK) != hasRow((State)s, EV_ACK))
+      return false;
+    bool canFail = spec.poll == POLL_ACK || spec.poll == POLL_LOOP;
+    if (canFail != (spec.failReason != nullptr))
+      return false;
+    if ((spec.poll == POLL_NONE) != (spec.txn == TXN_COUNT))
+      return false;
   }
+  return true;
+}
+
+static_assert(specsInStateOrder(), "STATE_SPECS must list every state in enum order");
+static_assert(transitionsInRange(), "transition with an invalid state or event");
+static_assert(noDuplicateTransitions(), "two transitions for the same state and event");
+static_assert(everyStateConnected(), "state unreachable or without a way out");
+static_assert(tickEventsHandled(), "state spec and transition table disagree");
+
+// Dense [state][event] lookup built from the table at compile time
+struct TransitionLookup
+{
+  uint8_t next[STATE_COUNT][EV_COUNT];
+};
+
+static constexpr uint8_t NO_TRANSITION = 0xFF;
+
+static constexpr TransitionLookup buildLookup() {
+  TransitionLookup l{};
+  for (uint8_t s = 0; s < STATE_COUNT; s++)
+    for (uint8_t e = 0; e < EV_COUNT; e++)
+      l.next[s][e] = NO_TRANSITION;
+  // wildcard rows first, so a state's own row wins
+  for (size_t i = 0; i < TRANSITION_COUNT; i++)
+    if (TRANSITIONS[i].from == ANY_STATE)
+      for (uint8_t s = 0; s < STATE_COUNT; s++)
+        l.next[s][TRANSITIONS[i].event] = TRANSITIONS[i].to;
+  for (size_t i = 0; i < TRANSITION_COUNT; i++)
+    if (TRANSITIONS[i].from != ANY_STATE)
+      l.next[TRANSITIONS[i].from][TRANSITIONS[i].event] = TRANSITIONS[i].to;
+  return l;
+}
+
+static constexpr TransitionLookup LOOKUP = buildLookup();
 
-  case SEND_B1_LOOP2:
+// ---- Timers owned by the state machine ----
+
+static void onStateTimeout(void *arg) {
+  dispatch(*(StateMachineContext *)arg, EV_TIMEOUT);
+}
+
+// slow A1 poll while idle so the auto-zero tracker keeps up with drift
+static void onIdlePoll(void *arg) {
+  if (txnStatus(TXN_A1) != TXN_PENDING)
+    txnBegin(TXN_A1);
+}
+
+static void armStateTimers(StateMachineContext &ctx, State s) {
+  const StateSpec &spec = STATE_SPECS[s];
+  uint16_t timeoutMs = spec.timeoutMs;
+  if (s == DONE && kioskActive())
+    timeoutMs = KIOSK_DONE_HOLD_MS; // the next person is waiting
+  if (spec.timeoutMs != 0)
+    timerOnce(TIMER_STATE, timeoutMs, onStateTimeout, &ctx);
+  else
+    timerCancel(TIMER_STATE);
+
+  // kiosk: poll faster so a step-on is seen at once
+  if (spec.poll == POLL_IDLE && AUTO_ZERO_ENABLED)
+    timerEvery(TIMER_IDLE_POLL, kioskPending() ? KIOSK_POLL_MS : AUTO_ZERO_POLL_MS, onIdlePoll);
+  else
+    timerCancel(TIMER_IDLE_POLL);
+}
+
+// ---- Dispatcher: the only place the state changes ----
+
+static void dispatch(StateMachineContext &ctx, FsmEvent ev) {
+  // entry actions may complete their state at once; bounded chain
+  for (uint8_t hop = 0; ev != EV_NONE && hop < STATE_COUNT; hop++)
   {
-    if (now - ctx.lastPollSendMs >= POLL_INTERVAL_MS)
-    {
-      ctx.lastPollSendMs = now;
-      Serial.println("Sending B1 (impedance read) second round ...");
-      send_cmd_B1();
-    }
-    if (ctx.mData.impedance_final_valid)
+    State from = ctx.currentState;
+    uint8_t next = LOOKUP.next[from][ev];
+    if (next == NO_TRANSITION)
     {
-      ctx.mData.imp_100k.rh = ctx.mData.imp_right_hand;
-      ctx.mData.imp_100k.lh = ctx.mData.imp_left_hand;
-      ctx.mData.imp_100k.trunk = ctx.mData.imp_trunk;
-      ctx.mData.imp_100k.rf = ctx.mData.imp_right_foot;
-      ctx.mData.imp_100k.lf = ctx.mData.imp_left_foot;
-      Serial.println("Impedance stabilized second round. Building final packet.");
-      ctx.currentState = BUILD_AND_SEND_FINAL;
+      LOG_DEBUG("Event %s ignored in %s", EVENT_NAMES[ev], STATE_SPECS[from].name);
+      return;
     }
-    break;
+    State to = (State)next;
+
+    if (STATE_SPECS[from].onExit)
+      STATE_SPECS[from].onExit(ctx);
+
+    unsigned long now = millis();
+    uint32_t spent = now - ctx.stateEnteredMs;
+    StateTiming &t = timings[from];
+    t.entries++;
+    t.totalMs += spent;
+    if (spent > t.maxMs)
+      t.maxMs = spent;
+
+    ctx.currentState = to;
+    ctx.stateEnteredMs = now;
+    LOG_INFO("=== Transitioning to %s state (%s) ===", STATE_SPECS[to].name, EVENT_NAMES[ev]);
+    pollTrackState(to);
+    armStateTimers(ctx, to);
+
+    ev = STATE_SPECS[to].onEntry ? STATE_SPECS[to].onEntry(ctx) : EV_NONE;
   }
+}
+
+void initStateMachine(StateMachineContext &ctx) {
+  ctx.currentState = WAIT_JSON;
+  ctx.stateEnteredMs = millis();
+  ctx.userInfo.valid = false;
+  initMeasurementData(ctx.mData);
+  pollTrackState(WAIT_JSON);
+  armStateTimers(ctx, WAIT_JSON);
+  if (AUTO_ZERO_ENABLED)
+    onIdlePoll(nullptr); // first auto-zero sample right away
+}
+
+const char *stateName(State s) {
+  return s < STATE_COUNT ? STATE_SPECS[s].name : "?";
+}
+
+const StateTiming &stateTiming(State s) {
+  return timings[s];
+}
+
+// Profile fields present in obj; the others keep their value
+static void readProfile(JsonObjectConst obj, UserInfo &user) {
+  if (obj.containsKey("gender"))
+    user.gender = (uint8_t)obj["gender"].as<int>();
+  if (obj.containsKey("product_id"))
+    user.product_id = (uint8_t)obj["product_id"].as<int>();
+  if (obj.containsKey("height"))
+    user.height = (uint16_t)obj["height"].as<int>();
+  if (obj.containsKey("age"))
+    user.age = (uint8_t)obj["age"].as<int>();
+  // "format":"bin" asks for the packed binary result, anything else is JSON
+  const char *format = obj["format"] | "json";
+  user.result_format = (strcmp(format, "bin") == 0) ? RESULT_FORMAT_BINARY : RESULT_FORMAT_JSON;
+  user.valid = true;
+}
 
-  case BUILD_AND_SEND_FINAL:
+// {"queue":[profile, ...]} appends kiosk profiles, {"queue":"clear"} drops them
+static void handleQueue(JsonVariantConst queue, StateMachineContext &ctx) {
+  if (queue.is<const char *>() && strcmp(queue.as<const char *>(), "clear") == 0)
   {
-    buildAndSendFinalPacket(ctx.userInfo, ctx.mData);
-    Serial.println("\n*** D0 packet sent! ***");
-    Serial.println("Waiting for calculation results (5 packets)...");
-    ctx.mData.resultPackets.reset();
-    ctx.currentState = WAIT_RESULT_PACKETS;
-    ctx.lastPollSendMs = millis();
-    break;
+    kioskClear();
+    LOG_INFO("Kiosk queue cleared");
   }
-
-  case WAIT_RESULT_PACKETS:
+  else
   {
-    // Check if all result packets received
-    if (ctx.mData.resultPackets.isComplete())
+    for (JsonObjectConst obj : queue.as<JsonArrayConst>())
     {
-      Serial.println("\n*** All result packets received! ***");
-      // Display result to Serial Monitor
-      parseAndDisplayResultJSON(ctx.mData.resultPackets, ctx.mData);
-      
-      // Send result via BLE if connected
-      if (bleHandler.isConnected())
+      UserInfo user = ctx.userInfo;
+      readProfile(obj, user);
+      if (!kioskEnqueue(user))
       {
-        String jsonResult = generateResultJSON(ctx.mData.resultPackets, ctx.mData);
-        bleHandler.sendData(jsonResult);
-        Serial.println("Result sent via BLE");
+        LOG_WARN("Kiosk queue full (%u), profile dropped", KIOSK_QUEUE_DEPTH);
+        break;
       }
-      
-      Serial.println("Please step off the scale...");
-      ctx.currentState = DONE;
-      ctx.lastPollSendMs = millis();
     }
-    else
-    {
-      // Timeout check (30 seconds)
-      if (now - ctx.lastPollSendMs >= 30000)
-      {
-        Serial.println("\n*** Timeout waiting for result packets! ***");
-        Serial.printf("Received only %d/%d packets\n", 
-                     ctx.mData.resultPackets.received_count,
-                     ctx.mData.resultPackets.total_packets);
-        ctx.currentState = DONE;
-        ctx.lastPollSendMs = millis();
-      }
-    }
-    break;
   }
+  // idle poll rate follows the queue
+  if (ctx.currentState == WAIT_JSON)
+    armStateTimers(ctx, WAIT_JSON);
+  kioskReport();
+}
 
-  case DONE:
+void handleJsonInput(const String &jsonStr, StateMachineContext &ctx) {
+  StaticJsonDocument<1536> doc; // room for a full kiosk queue
+  DeserializationError err = deserializeJson(doc, jsonStr);
+  if (err)
   {
-    if (now - ctx.lastPollSendMs >= 3000)
-    {
-      Serial.println("=== Transitioning to WAIT_SCALE_EMPTY state ===");
-      ctx.currentState = WAIT_SCALE_EMPTY;
-      ctx.lastPollSendMs = millis();
-    }
-    break;
+    LOG_WARN("JSON parse error: %s", err.c_str());
+    return;
   }
 
-  case WAIT_SCALE_EMPTY:
+  if (doc.containsKey("queue"))
   {
-    if (now - ctx.lastPollSendMs >= WEIGHT_POLL_INTERVAL_MS)
+    handleQueue(doc["queue"], ctx);
+    return;
+  }
+
+  readProfile(doc.as<JsonObjectConst>(), ctx.userInfo);
+  
+  LOG_INFO("User JSON accepted:");
+  LOG_INFO(" gender=%u product_id=%u height=%u age=%u format=%s",
+           ctx.userInfo.gender, ctx.userInfo.product_id,
+           ctx.userInfo.height, ctx.userInfo.age,
+           ctx.userInfo.result_format == RESULT_FORMAT_BINARY ? "bin" : "json");
+  
+  dispatch(ctx, EV_START);
+}
+
+void stateMachineOnFrame(const FrameView &frame, StateMachineContext &ctx) {
+  txnOnFrame(frame);
+  FsmEvent ev = processDeviceFrame(frame, ctx.mData, ctx.calib, ctx.currentState);
+  if (ev != EV_NONE)
+  {
+    dispatch(ctx, ev);
+    return;
+  }
+
+  const StateSpec &spec = STATE_SPECS[ctx.currentState];
+  if (spec.poll == POLL_ACK && txnStatus(spec.txn) == TXN_DONE)
+    dispatch(ctx, EV_ACK);
+}
+
+void processStateMachine(StateMachineContext &ctx) {
+  const StateSpec &spec = STATE_SPECS[ctx.currentState];
+
+  switch (spec.poll)
+  {
+  case POLL_NONE:
+  case POLL_IDLE: // TIMER_STATE / TIMER_IDLE_POLL do the work
+    break;
+
+  case POLL_ACK:
+    if (txnStatus(spec.txn) == TXN_FAILED)
+      abortSession(ctx, spec.failReason);
+    break;
+
+  case POLL_LOOP:
+    // abort when the poll keeps going unanswered
+    if (txnConsecutiveFailures(spec.txn) >= TXN_POLL_FAIL_LIMIT)
     {
-      ctx.lastPollSendMs = now;
-      send_cmd_A1();
+      abortSession(ctx, spec.failReason);
+      break;
     }
+    if (pollService(spec.txn))
+      LOG_DEBUG("Sending %s (%s)...", txnName(spec.txn), spec.name);
+    break;
+
+  case POLL_WAIT:
+    if (txnStatus(spec.txn) == TXN_FAILED)
+      dispatch(ctx, EV_TIMEOUT);
     break;
-  }
   }
 }
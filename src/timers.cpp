@@ -0,0 +1,130 @@
+// ตั้งเวลางานตาม deadline (one-shot / periodic) พร้อมสถิติความล่าช้า
+#include "timers.h"
+#include "log.h"
+
+struct Timer
+{
+  bool armed;
+  uint32_t dueUs;
+  uint32_t periodUs; // 0: one-shot
+  TimerJob job;
+  void *arg;
+};
+
+static const char *const TIMER_NAMES[TIMER_COUNT] = {
+    "state", "idle poll", "poll", "txn A0", "txn A1", "txn B0/03", "txn B0/06", "txn B1", "txn D0"};
+static_assert(TXN_COUNT == 6, "TIMER_NAMES must name every transaction timer");
+
+// A handful of fixed timers: a scan over the array beats a heap here
+static Timer timers[TIMER_COUNT];
+static TimerStats stats[TIMER_COUNT];
+
+static void arm(TimerId id, uint32_t delayMs, uint32_t periodMs, TimerJob job, void *arg)
+{
+  Timer &t = timers[id];
+  t.armed = true;
+  t.dueUs = (uint32_t)micros() + delayMs * 1000UL;
+  t.periodUs = periodMs * 1000UL;
+  t.job = job;
+  t.arg = arg;
+}
+
+void timerOnce(TimerId id, uint32_t delayMs, TimerJob job, void *arg)
+{
+  arm(id, delayMs, 0, job, arg);
+}
+
+void timerEvery(TimerId id, uint32_t periodMs, TimerJob job, void *arg)
+{
+  arm(id, periodMs, periodMs, job, arg);
+}
+
+void timerCancel(TimerId id)
+{
+  timers[id].armed = false;
+}
+
+bool timerArmed(TimerId id)
+{
+  return timers[id].armed;
+}
+
+void timersRun()
+{
+  for (uint8_t i = 0; i < TIMER_COUNT; i++)
+  {
+    Timer &t = timers[i];
+    uint32_t now = micros();
+    if (!t.armed || (int32_t)(now - t.dueUs) < 0)
+      continue;
+
+    uint32_t late = now - t.dueUs;
+    TimerStats &s = stats[i];
+    s.fired++;
+    s.lateSumUs += late;
+    if (late > s.lateMaxUs)
+      s.lateMaxUs = late;
+
+    if (t.periodUs != 0)
+    {
+      // next deadline from the last one, not from now: no drift
+      t.dueUs += t.periodUs;
+      while ((int32_t)(now - t.dueUs) >= 0)
+      {
+        t.dueUs += t.periodUs;
+        s.missed++;
+      }
+    }
+    else
+    {
+      t.armed = false;
+    }
+
+    // the job may re-arm or cancel any timer, this one included
+    if (t.job)
+      t.job(t.arg);
+  }
+}
+
+uint32_t timerNextMs()
+{
+  uint32_t now = micros();
+  uint32_t next = UINT32_MAX;
+  for (uint8_t i = 0; i < TIMER_COUNT; i++)
+  {
+    const Timer &t = timers[i];
+    if (!t.armed)
+      continue;
+    int32_t left = (int32_t)(t.dueUs - now);
+    if (left <= 0)
+      return 0;
+    uint32_t ms = ((uint32_t)left + 999) / 1000;
+    if (ms < next)
+      next = ms;
+  }
+  return next;
+}
+
+const TimerStats &timerStats(TimerId id)
+{
+  return stats[id];
+}
+
+void printTimerStats()
+{
+  for (uint8_t i = 0; i < TIMER_COUNT; i++)
+  {
+    const TimerStats &s = stats[i];
+    if (s.fired == 0)
+      continue;
+    LOG_INFO("Timer %-10s fired=%lu missed=%lu late avg=%lu us max=%lu us", TIMER_NAMES[i],
+             (unsigned long)s.fired, (unsigned long)s.missed,
+             (unsigned long)s.lateAvgUs(), (unsigned long)s.lateMaxUs);
+  }
+}
+
+void resetTimerStats()
+{
+  for (uint8_t i = 0; i < TIMER_COUNT; i++)
+    stats[i] = TimerStats();
+}
@@ -0,0 +1,227 @@
+// จับคู่คำสั่ง/คำตอบ, timeout, retry และสถิติ latency
+#include "transaction.h"
+#include "protocol.h"
+#include "config.h"
+#include "timers.h"
+#include "log.h"
+
+struct TxnSpec
+{
+  const char *name;
+  uint8_t order;        // order code of the response
+  const uint8_t *frame; // prebuilt frame (nullptr for D0)
+  uint8_t frameLen;
+  uint16_t timeoutMs;
+  uint8_t retries;
+  bool needsStatusOk;   // ACK frames carry 0x00 at byte 3 on success
+};
+
+static const TxnSpec specs[TXN_COUNT] = {
+    {"A0", 0xA0, CmdA0::bytes, CmdA0::size, TXN_ACK_TIMEOUT_MS, TXN_ACK_RETRIES, true},
+    {"A1", 0xA1, CmdA1::bytes, CmdA1::size, TXN_POLL_TIMEOUT_MS, 0, false},
+    {"B0/03", 0xB0, CmdB0_0303::bytes, CmdB0_0303::size, TXN_ACK_TIMEOUT_MS, TXN_ACK_RETRIES, true},
+    {"B0/06", 0xB0, CmdB0_0106::bytes, CmdB0_0106::size, TXN_ACK_TIMEOUT_MS, TXN_ACK_RETRIES, true},
+    {"B1", 0xB1, CmdB1::bytes, CmdB1::size, TXN_POLL_TIMEOUT_MS, 0, false},
+    {"D0", 0xD0, nullptr, 0, TXN_D0_TIMEOUT_MS, TXN_D0_RETRIES, false},
+};
+
+const uint16_t TXN_HIST_BOUNDS_MS[TXN_HIST_BUCKETS - 1] = {5, 10, 20, 50, 100, 200, 500};
+
+struct Txn
+{
+  TxnStatus status;
+  uint8_t attempts;
+  uint8_t failures; // consecutive failed transactions
+  uint32_t sentUs;    // frame written to the UART
+  bool writePending;  // queued, sentUs is still the enqueue time
+  const uint8_t *frame;          // the spec's constant frame, or `runtime`
+  uint8_t runtime[TX_SLOT_SIZE]; // D0, kept for its retries
+  uint8_t frameLen;
+};
+
+static Txn txns[TXN_COUNT];
+static TxnLatencyStats latency[TXN_COUNT];
+
+static void onResponseTimeout(void *arg);
+
+// pumpTx() wrote the frame: the round trip and the deadline start here,
+// not at enqueue, so a busy TX FIFO does not count as device latency
+static void onWritten(void *arg, uint32_t writeUs)
+{
+  TxnCommand cmd = (TxnCommand)(uintptr_t)arg;
+  Txn &t = txns[cmd];
+  if (t.status != TXN_PENDING || !t.writePending)
+    return;
+  t.writePending = false;
+  t.sentUs = writeUs;
+  timerOnce((TimerId)(TIMER_TXN + cmd), specs[cmd].timeoutMs, onResponseTimeout, arg);
+}
+
+static void transmit(TxnCommand cmd)
+{
+  Txn &t = txns[cmd];
+  void *arg = (void *)(uintptr_t)cmd;
+  t.attempts++;
+  // armed from enqueue too, so a frame dropped by a full queue still times
+  // out; onWritten() re-arms it (pumpTx may run inside sendRaw)
+  t.sentUs = micros();
+  t.writePending = true;
+  timerOnce((TimerId)(TIMER_TXN + cmd), specs[cmd].timeoutMs, onResponseTimeout, arg);
+  if (t.frame == t.runtime)
+    sendRaw(t.frame, t.frameLen, onWritten, arg);
+  else
+    sendConst(t.frame, t.frameLen, onWritten, arg);
+}
+
+void txnBegin(TxnCommand cmd)
+{
+  txnBegin(cmd, specs[cmd].frame, specs[cmd].frameLen);
+}
+
+void txnBegin(TxnCommand cmd, const uint8_t *frame, size_t len)
+{
+  if (!frame || len == 0 || len > TX_SLOT_SIZE)
+    return;
+  Txn &t = txns[cmd];
+  if (t.status == TXN_PENDING)
+  {
+    // previous request never answered
+    latency[cmd].timeouts++;
+    t.failures++;
+  }
+  if (frame == specs[cmd].frame)
+  {
+    t.frame = frame; // constant frame, sent from flash
+  }
+  else
+  {
+    memcpy(t.runtime, frame, len);
+    t.frame = t.runtime;
+  }
+  t.frameLen = (uint8_t)len;
+  t.attempts = 0;
+  t.status = TXN_PENDING;
+  transmit(cmd);
+}
+
+TxnStatus txnStatus(TxnCommand cmd)
+{
+  return txns[cmd].status;
+}
+
+uint8_t txnConsecutiveFailures(TxnCommand cmd)
+{
+  return txns[cmd].failures;
+}
+
+static void recordLatency(TxnCommand cmd, uint32_t us)
+{
+  TxnLatencyStats &s = latency[cmd];
+  s.count++;
+  s.lastUs = us;
+  s.sumUs += us;
+  if (s.count == 1 || us < s.minUs)
+    s.minUs = us;
+  if (us > s.maxUs)
+    s.maxUs = us;
+
+  uint32_t ms = us / 1000;
+  size_t b = 0;
+  while (b < TXN_HIST_BUCKETS - 1 && ms >= TXN_HIST_BOUNDS_MS[b])
+    ++b;
+  s.buckets[b]++;
+}
+
+void txnOnFrame(const FrameView &frame)
+{
+  if (frame.size() < 5)
+    return;
+  uint8_t order = frame[2];
+
+  for (uint8_t c = 0; c < TXN_COUNT; ++c)
+  {
+    Txn &t = txns[c];
+    if (t.status != TXN_PENDING || specs[c].order != order)
+      continue;
+    if (specs[c].needsStatusOk && frame[3] != 0x00)
+    {
+      LOG_WARN("%s rejected by device (status %02X)", specs[c].name, frame[3]);
+      continue; // let the timeout retry it
+    }
+    recordLatency((TxnCommand)c, (uint32_t)micros() - t.sentUs);
+    timerCancel((TimerId)(TIMER_TXN + c));
+    t.status = TXN_DONE;
+    t.failures = 0;
+    return;
+  }
+}
+
+// Response deadline passed: retry, or give up
+static void onResponseTimeout(void *arg)
+{
+  TxnCommand c = (TxnCommand)(uintptr_t)arg;
+  Txn &t = txns[c];
+  if (t.status != TXN_PENDING)
+    return;
+
+  latency[c].timeouts++;
+  if (t.attempts <= specs[c].retries)
+  {
+    LOG_WARN("%s timeout, retry %u/%u", specs[c].name, t.attempts, specs[c].retries);
+    latency[c].retries++;
+    transmit(c);
+  }
+  else
+  {
+    if (specs[c].retries > 0)
+      LOG_WARN("%s failed after %u attempts", specs[c].name, t.attempts);
+    t.status = TXN_FAILED;
+    t.failures++;
+  }
+}
+
+void txnReset()
+{
+  for (uint8_t c = 0; c < TXN_COUNT; ++c)
+  {
+    txns[c].status = TXN_IDLE;
+    txns[c].attempts = 0;
+    txns[c].failures = 0;
+    txns[c].writePending = false;
+    timerCancel((TimerId)(TIMER_TXN + c));
+  }
+}
+
+const TxnLatencyStats &txnLatency(TxnCommand cmd)
+{
+  return latency[cmd];
+}
+
+const char *txnName(TxnCommand cmd)
+{
+  return specs[cmd].name;
+}
+
+static_assert(TXN_HIST_BUCKETS == 8, "printTxnStats prints eight buckets");
+
+void printTxnStats()
+{
+  for (uint8_t c = 0; c < TXN_COUNT; ++c)
+  {
+    const TxnLatencyStats &s = latency[c];
+    if (s.count == 0 && s.timeouts == 0)
+      continue;
+    const uint32_t *h = s.buckets;
+    LOG_INFO("%-5s rtt avg=%luus min=%luus max=%luus n=%lu timeouts=%lu retries=%lu | %lu %lu %lu %lu %lu %lu %lu %lu",
+             specs[c].name, (unsigned long)s.avgUs(), (unsigned long)s.minUs,
+             (unsigned long)s.maxUs, (unsigned long)s.count,
+             (unsigned long)s.timeouts, (unsigned long)s.retries,
+             (unsigned long)h[0], (unsigned long)h[1], (unsigned long)h[2], (unsigned long)h[3],
+             (unsigned long)h[4], (unsigned long)h[5], (unsigned long)h[6], (unsigned long)h[7]);
+  }
+}
+
+void resetTxnStats()
+{
+  memset(latency, 0, sizeof(latency));
+}
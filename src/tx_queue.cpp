@@ -0,0 +1,87 @@
+// คิวส่งคำสั่งไปยัง BMH แบบไม่บล็อก
+#include "tx_queue.h"
+#include "log.h"
+#include <HardwareSerial.h>
+
+extern HardwareSerial BMH;
+
+static TxSlot slots[TX_QUEUE_SLOTS];
+static uint32_t nextSeq = 1;
+static TxQueueStats stats;
+
+static TxSlot *oldest(TxSlot::State state)
+{
+  TxSlot *found = nullptr;
+  for (size_t i = 0; i < TX_QUEUE_SLOTS; ++i)
+  {
+    if (slots[i].state == state && (!found || slots[i].seq < found->seq))
+      found = &slots[i];
+  }
+  return found;
+}
+
+static uint32_t enqueue(const uint8_t *data, size_t len, bool copy, TxWrittenFn onWritten, void *arg)
+{
+  if (len == 0 || len > TX_SLOT_SIZE)
+    return 0;
+
+  TxSlot *slot = oldest(TxSlot::FREE);
+  if (!slot)
+  {
+    stats.dropped++;
+    return 0;
+  }
+
+  if (copy)
+  {
+    memcpy(slot->copy, data, len);
+    data = slot->copy;
+  }
+  slot->data = data;
+  slot->len = (uint8_t)len;
+  slot->seq = nextSeq++;
+  slot->enqueueUs = micros();
+  slot->onWritten = onWritten;
+  slot->arg = arg;
+  slot->state = TxSlot::QUEUED;
+  return slot->seq;
+}
+
+uint32_t txEnqueue(const uint8_t *data, size_t len, TxWrittenFn onWritten, void *arg)
+{
+  return enqueue(data, len, true, onWritten, arg);
+}
+
+uint32_t txEnqueueConst(const uint8_t *data, size_t len, TxWrittenFn onWritten, void *arg)
+{
+  return enqueue(data, len, false, onWritten, arg);
+}
+
+bool pumpTx()
+{
+  TxSlot *slot;
+  while ((slot = oldest(TxSlot::QUEUED)) != nullptr)
+  {
+    if (BMH.availableForWrite() < (int)slot->len)
+      return true; // FIFO busy, try again next pass
+
+    BMH.write(slot->data, slot->len);
+    LOG_TRACE_HEX("TX ->", slot->data, slot->len);
+    uint32_t now = micros();
+    slot->state = TxSlot::FREE;
+
+    uint32_t wait = now - slot->enqueueUs;
+    if (wait > stats.maxWaitUs)
+      stats.maxWaitUs = wait;
+    stats.waitSumUs += wait;
+    stats.sent++;
+    if (slot->onWritten)
+      slot->onWritten(slot->arg, now);
+  }
+  return false;
+}
+
+const TxQueueStats &txQueueStats()
+{
+  return stats;
+}
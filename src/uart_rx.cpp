@@ -0,0 +1,70 @@
+// รับข้อมูล UART แบบ event-driven
+#include "uart_rx.h"
+#include "buffer.h"
+#include "config.h"
+#include <atomic>
+
+static HardwareSerial *rxPort = nullptr;
+static TaskHandle_t consumerTask = nullptr;
+static std::atomic<uint32_t> lastChunkUs{0};
+static RxLatencyStats latency;
+
+// Runs in the UART driver's event task (producer side of rxRing)
+static void onUartReceive()
+{
+  // whole backlog in one chunk: readBytes straight into the ring
+  size_t n = rxPort->available();
+  if (n > 0)
+    pushRxBytes(*rxPort, n);
+  lastChunkUs.store((uint32_t)micros(), std::memory_order_release);
+
+  // wake the protocol loop only when enough bytes for a frame are buffered
+  if (consumerTask && rxRing.available() >= frameDecoder.bytesWanted())
+    xTaskNotifyGive(consumerTask);
+}
+
+void beginUartRx(HardwareSerial &port)
+{
+  rxPort = &port;
+  consumerTask = xTaskGetCurrentTaskHandle();
+  resetRxLatencyStats();
+  port.setRxTimeout(UART_RX_TIMEOUT_SYMBOLS);
+  port.onReceive(onUartReceive, false);
+}
+
+void wakeRxWaiter()
+{
+  if (consumerTask)
+    xTaskNotifyGive(consumerTask);
+}
+
+bool waitForRxFrame(uint32_t timeoutMs)
+{
+  return ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs)) > 0;
+}
+
+void recordRxLatency()
+{
+  uint32_t us = (uint32_t)micros() - lastChunkUs.load(std::memory_order_acquire);
+  latency.lastUs = us;
+  latency.count++;
+  latency.sumUs += us;
+  if (us < latency.minUs)
+    latency.minUs = us;
+  if (us > latency.maxUs)
+    latency.maxUs = us;
+}
+
+const RxLatencyStats &rxLatencyStats()
+{
+  return latency;
+}
+
+void resetRxLatencyStats()
+{
+  latency.count = 0;
+  latency.lastUs = 0;
+  latency.minUs = UINT32_MAX;
+  latency.maxUs = 0;
+  latency.sumUs = 0;
+}
@@ -0,0 +1,157 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Minimal Arduino API for the native test environment ([env:native]).
+// Only what the host-built modules and tests use; nothing here runs on
+// the ESP32.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+#define HEX 16
+#define DEC 10
+
+inline uint32_t micros()
+{
+  using namespace std::chrono;
+  return (uint32_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+inline uint32_t millis()
+{
+  return micros() / 1000;
+}
+
+class Stream
+{
+public:
+  virtual ~Stream() {}
+  virtual int available() = 0;
+  virtual int read() = 0;
+
+  virtual size_t readBytes(uint8_t *buf, size_t len)
+  {
+    size_t n = 0;
+    int c;
+    while (n < len && (c = read()) >= 0)
+      buf[n++] = (uint8_t)c;
+    return n;
+  }
+};
+
+// Arduino String subset. The buffer grows through new[]/delete[] so host
+// benchmarks can count the heap traffic by replacing operator new[].
+class String
+{
+public:
+  String(const char *s = "") { assign(s, strlen(s)); }
+  String(const String &o) { assign(o.buf, o.len); }
+  String(char c) { assign(&c, 1); }
+  String(int v, unsigned char base = DEC) { fromLong(v, base); }
+  String(unsigned int v, unsigned char base = DEC) { fromULong(v, base); }
+  String(long v, unsigned char base = DEC) { fromLong(v, base); }
+  String(unsigned long v, unsigned char base = DEC) { fromULong(v, base); }
+  String(unsigned char v, unsigned char base = DEC) { fromULong(v, base); }
+  String(double v, unsigned char decimals = 2)
+  {
+    char tmp[40];
+    snprintf(tmp, sizeof(tmp), "%.*f", (int)decimals, v);
+    assign(tmp, strlen(tmp));
+  }
+  String(float v, unsigned char decimals = 2) : String((double)v, decimals) {}
+  ~String() { delete[] buf; }
+
+  String &operator=(const String &o)
+  {
+    if (this != &o)
+    {
+      len = 0;
+      append(o.buf, o.len);
+    }
+    return *this;
+  }
+
+  String &operator+=(const String &o) { return append(o.buf, o.len); }
+  String &operator+=(const char *s) { return append(s, strlen(s)); }
+  String &operator+=(char c) { return append(&c, 1); }
+
+  friend String operator+(const String &a, const String &b)
+  {
+    String r(a);
+    r += b;
+    return r;
+  }
+  friend String operator+(const char *a, const String &b)
+  {
+    String r(a);
+    r += b;
+    return r;
+  }
+  friend String operator+(const String &a, const char *b)
+  {
+    String r(a);
+    r += b;
+    return r;
+  }
+
+  bool reserve(size_t size)
+  {
+    grow(size);
+    return true;
+  }
+  size_t length() const { return len; }
+  const char *c_str() const { return buf; }
+  bool operator==(const char *s) const { return strcmp(buf, s) == 0; }
+
+private:
+  void fromLong(long v, int base)
+  {
+    char tmp[24];
+    if (base == HEX)
+      snprintf(tmp, sizeof(tmp), "%lx", (unsigned long)v);
+    else
+      snprintf(tmp, sizeof(tmp), "%ld", v);
+    assign(tmp, strlen(tmp));
+  }
+  void fromULong(unsigned long v, int base)
+  {
+    char tmp[24];
+    snprintf(tmp, sizeof(tmp), (base == HEX) ? "%lx" : "%lu", v);
+    assign(tmp, strlen(tmp));
+  }
+  void assign(const char *s, size_t n)
+  {
+    len = 0;
+    append(s, n);
+  }
+  void grow(size_t n)
+  {
+    if (buf && n <= cap)
+      return;
+    char *b = new char[n + 1];
+    if (buf)
+      memcpy(b, buf, len + 1);
+    delete[] buf;
+    buf = b;
+    cap = n;
+  }
+  String &append(const char *s, size_t n)
+  {
+    grow(len + n);
+    memcpy(buf + len, s, n);
+    len += n;
+    buf[len] = '\0';
+    return *this;
+  }
+
+  char *buf = nullptr;
+  size_t len = 0;
+  size_t cap = 0;
+};
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,34 @@
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+// EEPROM emulation for the native test environment: a RAM array that
+// tests fill with put() before calling loadCalibration().
+
+#include <Arduino.h>
+
+class EEPROMClass
+{
+public:
+  bool begin(size_t) { return true; }
+
+  template <typename T>
+  T &get(int addr, T &value)
+  {
+    memcpy(&value, &bytes[addr], sizeof(T));
+    return value;
+  }
+
+  template <typename T>
+  const T &put(int addr, const T &value)
+  {
+    memcpy(&bytes[addr], &value, sizeof(T));
+    return value;
+  }
+
+private:
+  uint8_t bytes[512] = {};
+};
+
+inline EEPROMClass EEPROM;
+
+#endif // HOST_EEPROM_H
@@ -0,0 +1,167 @@
+// adcToGrams / adcSpanToGrams เทียบกับการคำนวณ double ทุกค่า ADC
+#include <unity.h>
+#include "config.h"
+#include "calibration.h"
+#include <EEPROM.h>
+
+// Counts reaching the conversion are the difference of two 24-bit
+// readings (raw - tare), so this covers every value they can take
+static const int32_t COUNTS_MIN = -(1 << 24);
+static const int32_t COUNTS_MAX = (1 << 24) - 1;
+
+struct CalibCase
+{
+  const char *name;
+  float scale; // kg per count
+  float offset;
+};
+
+// |scale * 1000 * 2^24| stays under 2^31 g, so every result fits int32
+static const CalibCase CASES[] = {
+    {"typical", 1.0e-4f, 0.0f},
+    {"fractional offset", 1.2345e-4f, 1234.56f},
+    {"negative slope", -9.87e-5f, -777.25f},
+    {"large slope", 0.1f, -0.5f},
+    {"tiny slope, shift clamped to 62", 1.0e-11f, 5.5f},
+    {"slope just under a power of two", 0.00102399f, 0.0f},
+    {"slope just over a power of two", 0.00102401f, 3.0f},
+    {"zero slope", 0.0f, 100.0f},
+};
+
+void setUp() {}
+void tearDown() {}
+
+static CalibData prepared(float scale, float offset)
+{
+  CalibData c;
+  c.scale_factor = scale;
+  c.offset = offset;
+  prepareCalibration(c);
+  return c;
+}
+
+// floor(a * b + 0.5) in double, without the rounding of a * b: with a
+// 100 g/count slope the product needs ~59 bits and a plain double
+// multiply lands on the wrong side of .5 for a few counts. fma() gives the
+// rounding error of the product, which only matters on an exact .5.
+static int32_t roundedProduct(double a, double b)
+{
+  double p = a * b;
+  double err = fma(a, b, -p);
+  double t = p + 0.5;
+  double r = floor(t);
+  if (t == r && err < 0)
+    r -= 1;
+  return (int32_t)r;
+}
+
+// The float path this replaced, in double: (counts - offset) * scale, in g.
+// counts - offset is exact for these offsets, and so is scale * 1000.
+static int32_t referenceGrams(const CalibCase &k, int32_t counts)
+{
+  return roundedProduct((double)counts - (double)k.offset, (double)k.scale * 1000.0);
+}
+
+static int32_t referenceSpan(const CalibCase &k, int32_t counts)
+{
+  return roundedProduct((double)counts, (double)k.scale * 1000.0);
+}
+
+static void sweep(const CalibCase &k)
+{
+  CalibData c = prepared(k.scale, k.offset);
+  uint32_t mismatches = 0;
+  int32_t first = 0;
+  for (int32_t counts = COUNTS_MIN;; counts++)
+  {
+    if (adcToGrams(c, counts) != referenceGrams(k, counts) ||
+        adcSpanToGrams(c, counts) != referenceSpan(k, counts))
+    {
+      if (mismatches++ == 0)
+        first = counts;
+    }
+    if (counts == COUNTS_MAX)
+      break;
+  }
+
+  char msg[96];
+  snprintf(msg, sizeof(msg), "%s: %lu mismatches, first at counts=%ld", k.name,
+           (unsigned long)mismatches, (long)first);
+  TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, mismatches, msg);
+}
+
+static void test_full_range_matches_double_reference()
+{
+  for (const CalibCase &k : CASES)
+    sweep(k);
+}
+
+static void test_shift_keeps_slope_bits()
+{
+  for (const CalibCase &k : CASES)
+  {
+    CalibData c = prepared(k.scale, k.offset);
+    if (c.slope_q == 0)
+      continue;
+    uint64_t mag = (uint64_t)llabs(c.slope_q);
+    TEST_ASSERT_TRUE(mag < (1ULL << CALIB_SLOPE_BITS));
+    // below the clamp the slope uses all CALIB_SLOPE_BITS bits
+    if (c.slope_shift < 62)
+      TEST_ASSERT_TRUE(mag >= (1ULL << (CALIB_SLOPE_BITS - 1)));
+  }
+}
+
+static void test_shift_clamped_for_tiny_slope()
+{
+  CalibData c = prepared(1.0e-11f, 0.0f);
+  TEST_ASSERT_EQUAL_UINT8(62, c.slope_shift);
+  TEST_ASSERT_TRUE(c.slope_q != 0);
+}
+
+static void test_invalid_calibration_reads_zero()
+{
+  const float bad[] = {NAN, INFINITY, -INFINITY};
+  for (float v : bad)
+  {
+    CalibData c = prepared(v, 0.0f);
+    TEST_ASSERT_EQUAL_INT64(0, c.slope_q);
+    TEST_ASSERT_EQUAL_INT64(0, c.offset_q);
+    TEST_ASSERT_EQUAL_UINT8(0, c.slope_shift);
+    TEST_ASSERT_EQUAL_INT32(0, adcToGrams(c, COUNTS_MAX));
+
+    c = prepared(1.0e-4f, v);
+    TEST_ASSERT_EQUAL_INT32(0, adcToGrams(c, COUNTS_MIN));
+  }
+}
+
+static void test_load_prepares_fixed_point()
+{
+  EEPROM.put(0, 1.2345e-4f);
+  EEPROM.put(4, 1234.56f);
+  CalibData loaded;
+  loadCalibration(loaded);
+  CalibData expected = prepared(1.2345e-4f, 1234.56f);
+  TEST_ASSERT_EQUAL_INT64(expected.slope_q, loaded.slope_q);
+  TEST_ASSERT_EQUAL_INT64(expected.offset_q, loaded.offset_q);
+  TEST_ASSERT_EQUAL_UINT8(expected.slope_shift, loaded.slope_shift);
+}
+
+static void test_deci_kg_rounds_half_away_from_zero()
+{
+  TEST_ASSERT_EQUAL_INT32(654, gramsToDeciKg(65449));
+  TEST_ASSERT_EQUAL_INT32(655, gramsToDeciKg(65450));
+  TEST_ASSERT_EQUAL_INT32(-655, gramsToDeciKg(-65450));
+  TEST_ASSERT_EQUAL_INT32(0, gramsToDeciKg(-49));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_full_range_matches_double_reference);
+  RUN_TEST(test_shift_keeps_slope_bits);
+  RUN_TEST(test_shift_clamped_for_tiny_slope);
+  RUN_TEST(test_invalid_calibration_reads_zero);
+  RUN_TEST(test_load_prepares_fixed_point);
+  RUN_TEST(test_deci_kg_rounds_half_away_from_zero);
+  return UNITY_END();
+}
@@ -0,0 +1,277 @@
+// ถอดรหัสแพ็กเก็ตผล 0x51-0x55 เทียบกับ offset เดิมที่เขียนมือ
+#include <unity.h>
+#include "result_schema.h"
+#include "protocol.h"
+
+static const uint32_t BENCH_RUNS = 200000;
+
+// One D0 answer for a 65.4 kg user, built with the layout of
+// docs/BMH_PROTOCOL.md: header, length, 0xD0, package number, error,
+// fields, checksum. Control values are negative on purpose.
+static const uint8_t PACKET_51[] = {
+    0xAA, 0x50, 0xD0, 0x51, 0x00, 0x8E, 0x02, 0x28, 0x02, 0xEA, 0x02, 0x69,
+    0x01, 0x4B, 0x01, 0x95, 0x01, 0x9E, 0x00, 0x65, 0x00, 0xA2, 0x00, 0x61,
+    0x00, 0x59, 0x00, 0x6D, 0x00, 0x26, 0x00, 0x1F, 0x00, 0x26, 0x00, 0xF0,
+    0x01, 0xC4, 0x01, 0x28, 0x02, 0xCA, 0x01, 0xA5, 0x01, 0x03, 0x02, 0x26,
+    0x00, 0x1E, 0x00, 0x26, 0x00, 0x13, 0x01, 0x09, 0x01, 0x43, 0x01, 0xE0,
+    0x00, 0xCE, 0x00, 0xFC, 0x00, 0x89, 0x00, 0x7D, 0x00, 0x99, 0x00, 0x37,
+    0x01, 0x2C, 0x01, 0x6E, 0x01, 0x79, 0x00, 0x04,
+};
+static const uint8_t PACKET_52[] = {
+    0xAA, 0x2E, 0xD0, 0x52, 0x00, 0x09, 0x00, 0x0A, 0x00, 0x52, 0x00, 0x19,
+    0x00, 0x1A, 0x00, 0xB9, 0x00, 0xC4, 0x00, 0xE3, 0x00, 0xAB, 0x00, 0xAE,
+    0x00, 0x22, 0x00, 0x21, 0x00, 0x00, 0x01, 0x5C, 0x00, 0x5B, 0x00, 0xF4,
+    0x03, 0xDA, 0x03, 0x13, 0x04, 0xE6, 0x03, 0xE9, 0x03, 0xFA,
+};
+static const uint8_t PACKET_53[] = {
+    0xAA, 0x3A, 0xD0, 0x53, 0x00, 0x4E, 0x21, 0x08, 0x4C, 0x58, 0x50, 0x5A,
+    0x07, 0x01, 0x09, 0x08, 0x04, 0x84, 0x03, 0x4C, 0x04, 0xE2, 0x00, 0xB9,
+    0x00, 0xF0, 0x00, 0xF1, 0x00, 0x8C, 0x00, 0xC8, 0x00, 0xE8, 0x05, 0x8C,
+    0x05, 0xC7, 0x06, 0xE8, 0x08, 0xE5, 0x01, 0x4A, 0x02, 0xE0, 0xFF, 0x29,
+    0x00, 0xC9, 0xFF, 0xC6, 0x00, 0x6E, 0x00, 0xAA, 0x00, 0x55,
+};
+static const uint8_t PACKET_54[] = {
+    0xAA, 0x16, 0xD0, 0x54, 0x00, 0xA4, 0x00, 0xB4, 0x00, 0xC4, 0x00, 0x47,
+    0x01, 0x0C, 0x02, 0x88, 0x01, 0xCA, 0x01, 0x06, 0x01, 0x4F,
+};
+static const uint8_t PACKET_55[] = {
+    0xAA, 0x16, 0xD0, 0x55, 0x00, 0x01, 0x01, 0x02, 0x00, 0x01, 0x01, 0x00,
+    0x01, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x11,
+};
+
+static const uint8_t *const PACKETS[RESULT_PACKET_COUNT] = {PACKET_51, PACKET_52, PACKET_53, PACKET_54, PACKET_55};
+static const size_t PACKET_SIZES[RESULT_PACKET_COUNT] = {sizeof(PACKET_51), sizeof(PACKET_52), sizeof(PACKET_53),
+                                                          sizeof(PACKET_54), sizeof(PACKET_55)};
+
+static const ImpedanceData IMP_20K = {3542, 3611, 268, 2915, 2950};
+static const ImpedanceData IMP_100K = {3188, 3240, 231, 2602, 2637};
+
+void setUp() {}
+void tearDown() {}
+
+// What processDeviceFrame does with each D0 answer
+static void receive(ResultPackets &packets, uint8_t mask)
+{
+  packets.reset();
+  for (uint8_t i = 0; i < RESULT_PACKET_COUNT; i++)
+  {
+    if (!(mask & (1u << i)))
+      continue;
+    memcpy(packets.slot(i), PACKETS[i], PACKET_SIZES[i]);
+    packets.markReceived(i);
+  }
+}
+
+static void assertSegments(const SegmentResult &s, int32_t rh, int32_t lh, int32_t tr, int32_t rf, int32_t lf)
+{
+  TEST_ASSERT_EQUAL_INT32(rh, s.right_hand);
+  TEST_ASSERT_EQUAL_INT32(lh, s.left_hand);
+  TEST_ASSERT_EQUAL_INT32(tr, s.trunk);
+  TEST_ASSERT_EQUAL_INT32(rf, s.right_foot);
+  TEST_ASSERT_EQUAL_INT32(lf, s.left_foot);
+}
+
+static void test_fixture_lengths_and_checksums()
+{
+  for (uint8_t i = 0; i < RESULT_PACKET_COUNT; i++)
+  {
+    const uint8_t *p = PACKETS[i];
+    TEST_ASSERT_EQUAL_size_t(RESULT_PACKET_LEN[i], PACKET_SIZES[i]);
+    TEST_ASSERT_EQUAL_UINT8(RESULT_PACKET_LEN[i], p[1]);
+    TEST_ASSERT_EQUAL_UINT8(RESULT_FIRST_PACKAGE + i, p[3]);
+    TEST_ASSERT_EQUAL_UINT8(RESULT_SCHEMA[i].packageNo, p[3]);
+    TEST_ASSERT_EQUAL_UINT8(RESULT_SCHEMA[i].length, p[1]);
+    uint8_t sum = 0;
+    for (size_t k = 0; k < PACKET_SIZES[i]; k++)
+      sum += p[k];
+    TEST_ASSERT_EQUAL_UINT8(0, sum);
+  }
+}
+
+// Every field against the offsets the old parseAndDisplayResultJSON /
+// generateResultJSON read by hand
+static void test_decode_matches_hand_coded_offsets()
+{
+  ResultPackets packets;
+  receive(packets, 0x1F);
+  MeasurementResult r;
+  decodeMeasurementResult(packets, IMP_20K, IMP_100K, r);
+  const BodyCompositionResult &b = r.body;
+
+  TEST_ASSERT_EQUAL_UINT8(ERROR_TYPE_NONE, r.errorCode);
+  TEST_ASSERT_EQUAL_UINT8(5, r.totalPackets);
+  TEST_ASSERT_EQUAL_UINT8(5, r.receivedPackets);
+  TEST_ASSERT_EQUAL_UINT8(0x1F, b.decodedMask);
+  TEST_ASSERT_EQUAL_MEMORY(&IMP_20K, &r.imp20k, sizeof(ImpedanceData));
+  TEST_ASSERT_EQUAL_MEMORY(&IMP_100K, &r.imp100k, sizeof(ImpedanceData));
+
+  // 0x51 body composition
+  const uint8_t *p = PACKET_51;
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[5]), b.weight);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[7]), b.weight_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[9]), b.weight_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[11]), b.moisture);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[13]), b.moisture_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[15]), b.moisture_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[17]), b.body_fat_mass);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[19]), b.body_fat_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[21]), b.body_fat_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[23]), b.protein_mass);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[25]), b.protein_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[27]), b.protein_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[29]), b.inorganic_salt);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[31]), b.inorganic_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[33]), b.inorganic_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[35]), b.lean_body_weight);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[37]), b.lean_body_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[39]), b.lean_body_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[41]), b.muscle_mass);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[43]), b.muscle_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[45]), b.muscle_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[47]), b.bone_mass);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[49]), b.bone_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[51]), b.bone_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[53]), b.skeletal_muscle);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[55]), b.skeletal_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[57]), b.skeletal_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[59]), b.ic_water);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[61]), b.ic_water_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[63]), b.ic_water_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[65]), b.ec_water);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[67]), b.ec_water_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[69]), b.ec_water_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[71]), b.body_cell_mass);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[73]), b.bcm_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[75]), b.bcm_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[77]), b.subcutaneous_fat_mass);
+  TEST_ASSERT_EQUAL_INT32(654, b.weight);
+
+  // 0x52 segmental analysis
+  p = PACKET_52;
+  assertSegments(b.seg_fat_mass, le_u16(&p[5]), le_u16(&p[7]), le_u16(&p[9]), le_u16(&p[11]), le_u16(&p[13]));
+  assertSegments(b.seg_fat_percent, le_u16(&p[15]), le_u16(&p[17]), le_u16(&p[19]), le_u16(&p[21]), le_u16(&p[23]));
+  assertSegments(b.seg_muscle_mass, le_u16(&p[25]), le_u16(&p[27]), le_u16(&p[29]), le_u16(&p[31]), le_u16(&p[33]));
+  assertSegments(b.seg_muscle_ratio, le_u16(&p[35]), le_u16(&p[37]), le_u16(&p[39]), le_u16(&p[41]), le_u16(&p[43]));
+
+  // 0x53 health metrics
+  p = PACKET_53;
+  TEST_ASSERT_EQUAL_INT32(p[5], b.body_score);
+  TEST_ASSERT_EQUAL_INT32(p[6], b.physical_age);
+  TEST_ASSERT_EQUAL_INT32(p[7], b.body_type);
+  TEST_ASSERT_EQUAL_INT32(p[8], b.smi);
+  TEST_ASSERT_EQUAL_INT32(p[9], b.whr);
+  TEST_ASSERT_EQUAL_INT32(p[10], b.whr_std_min);
+  TEST_ASSERT_EQUAL_INT32(p[11], b.whr_std_max);
+  TEST_ASSERT_EQUAL_INT32(p[12], b.visceral_fat);
+  TEST_ASSERT_EQUAL_INT32(p[13], b.vf_std_min);
+  TEST_ASSERT_EQUAL_INT32(p[14], b.vf_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[15]), b.obesity_percent);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[17]), b.obesity_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[19]), b.obesity_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[21]), b.bmi);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[23]), b.bmi_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[25]), b.bmi_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[27]), b.body_fat_percent);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[29]), b.body_fat_percent_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[31]), b.body_fat_percent_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[33]), b.bmr);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[35]), b.bmr_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[37]), b.bmr_std_max);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[39]), b.recommended_intake);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[41]), b.ideal_weight);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[43]), b.target_weight);
+  TEST_ASSERT_EQUAL_INT32((int16_t)le_u16(&p[45]), b.weight_control);
+  TEST_ASSERT_EQUAL_INT32((int16_t)le_u16(&p[47]), b.muscle_control);
+  TEST_ASSERT_EQUAL_INT32((int16_t)le_u16(&p[49]), b.fat_control);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[51]), b.subq_fat_percent);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[53]), b.subq_std_min);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[55]), b.subq_std_max);
+  TEST_ASSERT_EQUAL_INT32(-32, b.weight_control);
+  TEST_ASSERT_EQUAL_INT32(-55, b.fat_control);
+
+  // 0x54 energy consumption
+  p = PACKET_54;
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[5]), b.walk);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[7]), b.golf);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[9]), b.croquet);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[11]), b.tennis_cycling_basketball);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[13]), b.squash_tkd_fencing);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[15]), b.mountain_climbing);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[17]), b.swimming_aerobic_jog);
+  TEST_ASSERT_EQUAL_INT32(le_u16(&p[19]), b.badminton_table_tennis);
+
+  // 0x55 segmental standards
+  p = PACKET_55;
+  assertSegments(b.fat_standard, p[5], p[6], p[7], p[8], p[9]);
+  assertSegments(b.muscle_standard, p[10], p[11], p[12], p[13], p[14]);
+}
+
+// Packets that did not arrive stay zero and out of the mask
+static void test_missing_packets_left_out()
+{
+  ResultPackets packets;
+  receive(packets, 0x15); // 0x51, 0x53, 0x55
+  MeasurementResult r;
+  decodeMeasurementResult(packets, IMP_20K, IMP_100K, r);
+
+  TEST_ASSERT_EQUAL_UINT8(0x15, r.body.decodedMask);
+  TEST_ASSERT_EQUAL_UINT8(3, r.receivedPackets);
+  TEST_ASSERT_EQUAL_INT32(654, r.body.weight);
+  TEST_ASSERT_EQUAL_INT32(0, r.body.seg_fat_mass.trunk);
+  TEST_ASSERT_EQUAL_INT32(0, r.body.walk);
+  TEST_ASSERT_EQUAL_INT32(2, r.body.fat_standard.trunk);
+}
+
+// Schema tables: field count per packet and the binary layout size
+static void test_schema_tables()
+{
+  const uint8_t counts[RESULT_PACKET_COUNT] = {37, 20, 32, 8, 10};
+  for (uint8_t i = 0; i < RESULT_PACKET_COUNT; i++)
+    TEST_ASSERT_EQUAL_UINT8(counts[i], RESULT_SCHEMA[i].count);
+  TEST_ASSERT_EQUAL_UINT8(1, RESULT_SCHEMA_VERSION);
+
+  ResultPackets packets;
+  receive(packets, 0x1F);
+  MeasurementResult r;
+  decodeMeasurementResult(packets, IMP_20K, IMP_100K, r);
+  uint8_t bin[RESULT_BIN_MAX];
+  TEST_ASSERT_EQUAL_size_t(RESULT_BIN_MAX, encodeResultBinary(r, bin));
+  TEST_ASSERT_EQUAL_UINT8(RESULT_BIN_MARKER, bin[0]);
+  TEST_ASSERT_EQUAL_UINT8(0x1F, bin[3]);
+  TEST_ASSERT_EQUAL_UINT32(IMP_20K.rh, le_u32(&bin[4]));
+  // first field after the impedance block is the weight
+  TEST_ASSERT_EQUAL_UINT16(654, le_u16(&bin[RESULT_BIN_HEADER + 40]));
+}
+
+static void test_decode_speed()
+{
+  ResultPackets packets;
+  receive(packets, 0x1F);
+  MeasurementResult r;
+  uint32_t check = 0;
+  uint32_t t0 = micros();
+  for (uint32_t i = 0; i < BENCH_RUNS; i++)
+  {
+    packets.data[RESULT_PACKET_OFFSET[0] + 5] = (uint8_t)i; // keep the loop honest
+    decodeMeasurementResult(packets, IMP_20K, IMP_100K, r);
+    check += r.body.weight;
+  }
+  uint32_t us = micros() - t0;
+  TEST_ASSERT_TRUE(check != 0);
+
+  char msg[96];
+  snprintf(msg, sizeof(msg), "decodeMeasurementResult: %.1f ns per result (%lu runs)",
+           us * 1000.0 / BENCH_RUNS, (unsigned long)BENCH_RUNS);
+  TEST_MESSAGE(msg);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_fixture_lengths_and_checksums);
+  RUN_TEST(test_decode_matches_hand_coded_offsets);
+  RUN_TEST(test_missing_packets_left_out);
+  RUN_TEST(test_schema_tables);
+  RUN_TEST(test_decode_speed);
+  return UNITY_END();
+}
@@ -0,0 +1,421 @@
+// เบนช์มาร์ก JSON ผลการวัด: JsonWriter เทียบ String ต่อกันแบบเดิม
+#include <unity.h>
+#include <new>
+#include "result_sink.h"
+#include "protocol.h"
+
+static const int RESULTS = 200;
+static const int ROUNDS = 20;
+static const size_t NOTIFY_PAYLOAD = 244; // BLE notification at MTU 247
+
+void setUp() {}
+void tearDown() {}
+
+// ---- heap use: every new / new[] while counting is on ----
+static bool counting = false;
+static uint32_t allocations = 0;
+
+static void *countedAlloc(size_t n)
+{
+  if (counting)
+    allocations++;
+  if (void *p = malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void *operator new(size_t n) { return countedAlloc(n); }
+void *operator new[](size_t n) { return countedAlloc(n); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+// ---- the result generator before JsonWriter (measurement.cpp), with the
+// packet access updated to the current ResultPackets ----
+namespace legacy
+{
+String generateResultJSON(const ResultPackets &packets, const ImpedanceData &imp_20k, const ImpedanceData &imp_100k)
+{
+  String json = "";
+
+  // Check for errors first
+  if (packets.hasError())
+  {
+    json += "{\n";
+    json += "  \"status\": \"error\",\n";
+    json += "  \"error_code\": \"0x";
+    json += String(packets.error_type, HEX);
+    json += "\",\n";
+    json += "  \"error_message\": \"";
+    json += getErrorTypeString(packets.error_type);
+    json += "\"\n";
+    json += "}";
+    return json;
+  }
+
+  json += "{\n";
+  json += "  \"status\": \"success\",\n";
+  json += "  \"total_packets\": " + String(packets.total_packets) + ",\n";
+  json += "  \"received_packets\": " + String(packets.received_count) + ",\n";
+
+  // ===== RAW IMPEDANCE MEASUREMENTS (in Ohms) =====
+  json += "  \"impedance_measurements\": {\n";
+  json += "    \"20khz\": {\n";
+  json += "      \"right_hand_ohm\": " + String(imp_20k.rh / 10.0, 1) + ",\n";
+  json += "      \"left_hand_ohm\": " + String(imp_20k.lh / 10.0, 1) + ",\n";
+  json += "      \"trunk_ohm\": " + String(imp_20k.trunk / 10.0, 1) + ",\n";
+  json += "      \"right_foot_ohm\": " + String(imp_20k.rf / 10.0, 1) + ",\n";
+  json += "      \"left_foot_ohm\": " + String(imp_20k.lf / 10.0, 1) + "\n";
+  json += "    },\n";
+  json += "    \"100khz\": {\n";
+  json += "      \"right_hand_ohm\": " + String(imp_100k.rh / 10.0, 1) + ",\n";
+  json += "      \"left_hand_ohm\": " + String(imp_100k.lh / 10.0, 1) + ",\n";
+  json += "      \"trunk_ohm\": " + String(imp_100k.trunk / 10.0, 1) + ",\n";
+  json += "      \"right_foot_ohm\": " + String(imp_100k.rf / 10.0, 1) + ",\n";
+  json += "      \"left_foot_ohm\": " + String(imp_100k.lf / 10.0, 1) + "\n";
+  json += "    }\n";
+  json += "  },\n";
+
+  // ===== PACKET 1 (0x51) - Main body composition =====
+  if (packets.has(0))
+  {
+    const uint8_t *p = packets.packet(0);
+    json += "  \"body_composition\": {\n";
+
+    json += "    \"weight_kg\": " + String(le_u16(&p[5]) / 10.0, 1) + ",\n";
+    json += "    \"weight_std_min_kg\": " + String(le_u16(&p[7]) / 10.0, 1) + ",\n";
+    json += "    \"weight_std_max_kg\": " + String(le_u16(&p[9]) / 10.0, 1) + ",\n";
+
+    json += "    \"moisture_kg\": " + String(le_u16(&p[11]) / 10.0, 1) + ",\n";
+    json += "    \"moisture_std_min_kg\": " + String(le_u16(&p[13]) / 10.0, 1) + ",\n";
+    json += "    \"moisture_std_max_kg\": " + String(le_u16(&p[15]) / 10.0, 1) + ",\n";
+
+    json += "    \"body_fat_mass_kg\": " + String(le_u16(&p[17]) / 10.0, 1) + ",\n";
+    json += "    \"body_fat_std_min_kg\": " + String(le_u16(&p[19]) / 10.0, 1) + ",\n";
+    json += "    \"body_fat_std_max_kg\": " + String(le_u16(&p[21]) / 10.0, 1) + ",\n";
+
+    json += "    \"protein_mass_kg\": " + String(le_u16(&p[23]) / 10.0, 1) + ",\n";
+    json += "    \"protein_std_min_kg\": " + String(le_u16(&p[25]) / 10.0, 1) + ",\n";
+    json += "    \"protein_std_max_kg\": " + String(le_u16(&p[27]) / 10.0, 1) + ",\n";
+
+    json += "    \"inorganic_salt_kg\": " + String(le_u16(&p[29]) / 10.0, 1) + ",\n";
+    json += "    \"inorganic_std_min_kg\": " + String(le_u16(&p[31]) / 10.0, 1) + ",\n";
+    json += "    \"inorganic_std_max_kg\": " + String(le_u16(&p[33]) / 10.0, 1) + ",\n";
+
+    json += "    \"lean_body_weight_kg\": " + String(le_u16(&p[35]) / 10.0, 1) + ",\n";
+    json += "    \"lean_body_std_min_kg\": " + String(le_u16(&p[37]) / 10.0, 1) + ",\n";
+    json += "    \"lean_body_std_max_kg\": " + String(le_u16(&p[39]) / 10.0, 1) + ",\n";
+
+    json += "    \"muscle_mass_kg\": " + String(le_u16(&p[41]) / 10.0, 1) + ",\n";
+    json += "    \"muscle_std_min_kg\": " + String(le_u16(&p[43]) / 10.0, 1) + ",\n";
+    json += "    \"muscle_std_max_kg\": " + String(le_u16(&p[45]) / 10.0, 1) + ",\n";
+
+    json += "    \"bone_mass_kg\": " + String(le_u16(&p[47]) / 10.0, 1) + ",\n";
+    json += "    \"bone_std_min_kg\": " + String(le_u16(&p[49]) / 10.0, 1) + ",\n";
+    json += "    \"bone_std_max_kg\": " + String(le_u16(&p[51]) / 10.0, 1) + ",\n";
+
+    json += "    \"skeletal_muscle_kg\": " + String(le_u16(&p[53]) / 10.0, 1) + ",\n";
+    json += "    \"skeletal_std_min_kg\": " + String(le_u16(&p[55]) / 10.0, 1) + ",\n";
+    json += "    \"skeletal_std_max_kg\": " + String(le_u16(&p[57]) / 10.0, 1) + ",\n";
+
+    json += "    \"intracellular_water_kg\": " + String(le_u16(&p[59]) / 10.0, 1) + ",\n";
+    json += "    \"ic_water_std_min_kg\": " + String(le_u16(&p[61]) / 10.0, 1) + ",\n";
+    json += "    \"ic_water_std_max_kg\": " + String(le_u16(&p[63]) / 10.0, 1) + ",\n";
+
+    json += "    \"extracellular_water_kg\": " + String(le_u16(&p[65]) / 10.0, 1) + ",\n";
+    json += "    \"ec_water_std_min_kg\": " + String(le_u16(&p[67]) / 10.0, 1) + ",\n";
+    json += "    \"ec_water_std_max_kg\": " + String(le_u16(&p[69]) / 10.0, 1) + ",\n";
+
+    json += "    \"body_cell_mass_kg\": " + String(le_u16(&p[71]) / 10.0, 1) + ",\n";
+    json += "    \"bcm_std_min_kg\": " + String(le_u16(&p[73]) / 10.0, 1) + ",\n";
+    json += "    \"bcm_std_max_kg\": " + String(le_u16(&p[75]) / 10.0, 1) + ",\n";
+
+    json += "    \"subcutaneous_fat_mass_kg\": " + String(le_u16(&p[77]) / 10.0, 1) + "\n";
+    json += "  },\n";
+  }
+
+  // ===== PACKET 2 (0x52) - Segmental analysis =====
+  if (packets.has(1))
+  {
+    const uint8_t *p = packets.packet(1);
+    json += "  \"segmental_analysis\": {\n";
+
+    json += "    \"fat_mass_kg\": {\n";
+    json += "      \"right_hand\": " + String(le_u16(&p[5]) / 10.0, 1) + ",\n";
+    json += "      \"left_hand\": " + String(le_u16(&p[7]) / 10.0, 1) + ",\n";
+    json += "      \"trunk\": " + String(le_u16(&p[9]) / 10.0, 1) + ",\n";
+    json += "      \"right_foot\": " + String(le_u16(&p[11]) / 10.0, 1) + ",\n";
+    json += "      \"left_foot\": " + String(le_u16(&p[13]) / 10.0, 1) + "\n";
+    json += "    },\n";
+
+    json += "    \"fat_percent\": {\n";
+    json += "      \"right_hand\": " + String(le_u16(&p[15]) / 10.0, 1) + ",\n";
+    json += "      \"left_hand\": " + String(le_u16(&p[17]) / 10.0, 1) + ",\n";
+    json += "      \"trunk\": " + String(le_u16(&p[19]) / 10.0, 1) + ",\n";
+    json += "      \"right_foot\": " + String(le_u16(&p[21]) / 10.0, 1) + ",\n";
+    json += "      \"left_foot\": " + String(le_u16(&p[23]) / 10.0, 1) + "\n";
+    json += "    },\n";
+
+    json += "    \"muscle_mass_kg\": {\n";
+    json += "      \"right_hand\": " + String(le_u16(&p[25]) / 10.0, 1) + ",\n";
+    json += "      \"left_hand\": " + String(le_u16(&p[27]) / 10.0, 1) + ",\n";
+    json += "      \"trunk\": " + String(le_u16(&p[29]) / 10.0, 1) + ",\n";
+    json += "      \"right_foot\": " + String(le_u16(&p[31]) / 10.0, 1) + ",\n";
+    json += "      \"left_foot\": " + String(le_u16(&p[33]) / 10.0, 1) + "\n";
+    json += "    },\n";
+
+    json += "    \"muscle_ratio_percent\": {\n";
+    json += "      \"right_hand\": " + String(le_u16(&p[35]) / 10.0, 1) + ",\n";
+    json += "      \"left_hand\": " + String(le_u16(&p[37]) / 10.0, 1) + ",\n";
+    json += "      \"trunk\": " + String(le_u16(&p[39]) / 10.0, 1) + ",\n";
+    json += "      \"right_foot\": " + String(le_u16(&p[41]) / 10.0, 1) + ",\n";
+    json += "      \"left_foot\": " + String(le_u16(&p[43]) / 10.0, 1) + "\n";
+    json += "    }\n";
+    json += "  },\n";
+  }
+
+  // ===== PACKET 3 (0x53) - Health metrics =====
+  if (packets.has(2))
+  {
+    const uint8_t *p = packets.packet(2);
+    json += "  \"health_metrics\": {\n";
+
+    json += "    \"body_score\": " + String(p[5]) + ",\n";
+    json += "    \"physical_age\": " + String(p[6]) + ",\n";
+    json += "    \"body_type\": " + String(p[7]) + ",\n";
+    json += "    \"body_type_name\": \"" + String(getBodyTypeString(p[7])) + "\",\n";
+    json += "    \"smi\": " + String(p[8] / 10.0, 1) + ",\n";
+
+    json += "    \"whr\": " + String(p[9] * 0.01, 2) + ",\n";
+    json += "    \"whr_std_min\": " + String(p[10] * 0.01, 2) + ",\n";
+    json += "    \"whr_std_max\": " + String(p[11] * 0.01, 2) + ",\n";
+
+    json += "    \"visceral_fat\": " + String(p[12]) + ",\n";
+    json += "    \"vf_std_min\": " + String(p[13]) + ",\n";
+    json += "    \"vf_std_max\": " + String(p[14]) + ",\n";
+
+    json += "    \"obesity_percent\": " + String(le_u16(&p[15]) / 10.0, 1) + ",\n";
+    json += "    \"obesity_std_min\": " + String(le_u16(&p[17]) / 10.0, 1) + ",\n";
+    json += "    \"obesity_std_max\": " + String(le_u16(&p[19]) / 10.0, 1) + ",\n";
+
+    json += "    \"bmi\": " + String(le_u16(&p[21]) / 10.0, 1) + ",\n";
+    json += "    \"bmi_std_min\": " + String(le_u16(&p[23]) / 10.0, 1) + ",\n";
+    json += "    \"bmi_std_max\": " + String(le_u16(&p[25]) / 10.0, 1) + ",\n";
+
+    json += "    \"body_fat_percent\": " + String(le_u16(&p[27]) / 10.0, 1) + ",\n";
+    json += "    \"body_fat_std_min\": " + String(le_u16(&p[29]) / 10.0, 1) + ",\n";
+    json += "    \"body_fat_std_max\": " + String(le_u16(&p[31]) / 10.0, 1) + ",\n";
+
+    json += "    \"bmr_kcal\": " + String(le_u16(&p[33])) + ",\n";
+    json += "    \"bmr_std_min_kcal\": " + String(le_u16(&p[35])) + ",\n";
+    json += "    \"bmr_std_max_kcal\": " + String(le_u16(&p[37])) + ",\n";
+
+    json += "    \"recommended_intake_kcal\": " + String(le_u16(&p[39])) + ",\n";
+    json += "    \"ideal_weight_kg\": " + String(le_u16(&p[41]) / 10.0, 1) + ",\n";
+    json += "    \"target_weight_kg\": " + String(le_u16(&p[43]) / 10.0, 1) + ",\n";
+
+    int16_t weight_ctrl = (int16_t)le_u16(&p[45]);
+    int16_t muscle_ctrl = (int16_t)le_u16(&p[47]);
+    int16_t fat_ctrl = (int16_t)le_u16(&p[49]);
+    json += "    \"weight_control_kg\": " + String(weight_ctrl / 10.0, 1) + ",\n";
+    json += "    \"muscle_control_kg\": " + String(muscle_ctrl / 10.0, 1) + ",\n";
+    json += "    \"fat_control_kg\": " + String(fat_ctrl / 10.0, 1) + ",\n";
+
+    json += "    \"subcutaneous_fat_percent\": " + String(le_u16(&p[51]) / 10.0, 1) + ",\n";
+    json += "    \"subq_std_min\": " + String(le_u16(&p[53]) / 10.0, 1) + ",\n";
+    json += "    \"subq_std_max\": " + String(le_u16(&p[55]) / 10.0, 1) + "\n";
+    json += "  },\n";
+  }
+
+  // ===== PACKET 4 (0x54) - Energy consumption =====
+  if (packets.has(3))
+  {
+    const uint8_t *p = packets.packet(3);
+    json += "  \"energy_consumption_kcal_per_30min\": {\n";
+
+    json += "    \"walk\": " + String(le_u16(&p[5])) + ",\n";
+    json += "    \"golf\": " + String(le_u16(&p[7])) + ",\n";
+    json += "    \"croquet\": " + String(le_u16(&p[9])) + ",\n";
+    json += "    \"tennis_cycling_basketball\": " + String(le_u16(&p[11])) + ",\n";
+    json += "    \"squash_tkd_fencing\": " + String(le_u16(&p[13])) + ",\n";
+    json += "    \"mountain_climbing\": " + String(le_u16(&p[15])) + ",\n";
+    json += "    \"swimming_aerobic_jog\": " + String(le_u16(&p[17])) + ",\n";
+    json += "    \"badminton_table_tennis\": " + String(le_u16(&p[19])) + "\n";
+    json += "  },\n";
+  }
+
+  // ===== PACKET 5 (0x55) - Standard classifications =====
+  if (packets.has(4))
+  {
+    const uint8_t *p = packets.packet(4);
+    json += "  \"segmental_standards\": {\n";
+
+    json += "    \"fat_standard\": {\n";
+    json += "      \"right_hand\": \"" + String(getStdLevelString(p[5])) + "\",\n";
+    json += "      \"left_hand\": \"" + String(getStdLevelString(p[6])) + "\",\n";
+    json += "      \"trunk\": \"" + String(getStdLevelString(p[7])) + "\",\n";
+    json += "      \"right_foot\": \"" + String(getStdLevelString(p[8])) + "\",\n";
+    json += "      \"left_foot\": \"" + String(getStdLevelString(p[9])) + "\"\n";
+    json += "    },\n";
+
+    json += "    \"muscle_standard\": {\n";
+    json += "      \"right_hand\": \"" + String(getStdLevelString(p[10])) + "\",\n";
+    json += "      \"left_hand\": \"" + String(getStdLevelString(p[11])) + "\",\n";
+    json += "      \"trunk\": \"" + String(getStdLevelString(p[12])) + "\",\n";
+    json += "      \"right_foot\": \"" + String(getStdLevelString(p[13])) + "\",\n";
+    json += "      \"left_foot\": \"" + String(getStdLevelString(p[14])) + "\"\n";
+    json += "    }\n";
+    json += "  }\n";
+  }
+
+  json += "}";
+  return json;
+}
+} // namespace legacy
+
+struct Sample
+{
+  ResultPackets packets;
+  ImpedanceData imp20k, imp100k;
+  MeasurementResult result;
+};
+
+static Sample samples[RESULTS];
+
+static void randomSamples()
+{
+  srand(1234);
+  for (Sample &s : samples)
+  {
+    s.packets.reset();
+    for (uint8_t i = 0; i < RESULT_PACKET_COUNT; i++)
+    {
+      uint8_t *p = s.packets.slot(i);
+      for (size_t k = 0; k < s.packets.length(i); k++)
+        p[k] = (uint8_t)rand();
+      p[0] = 0xAA;
+      p[1] = RESULT_PACKET_LEN[i];
+      p[2] = 0xD0;
+      p[3] = RESULT_FIRST_PACKAGE + i;
+      p[4] = ERROR_TYPE_NONE;
+      s.packets.markReceived(i);
+    }
+    // health byte fields hold small codes, levels are 0..2
+    uint8_t *p3 = s.packets.slot(2);
+    p3[7] = 1 + rand() % 9;
+    uint8_t *p5 = s.packets.slot(4);
+    for (uint8_t k = 5; k < 15; k++)
+      p5[k] = rand() % 3;
+
+    uint32_t *imp = &s.imp20k.rh;
+    for (uint8_t k = 0; k < 10; k++)
+      imp[k] = 1000 + rand() % 60000; // both blocks, 100 to 6100 ohm
+    decodeMeasurementResult(s.packets, s.imp20k, s.imp100k, s.result);
+  }
+}
+
+static void discard(void *, const char *, size_t) {}
+
+struct Run
+{
+  const char *name;
+  size_t bytes;        // per result (average)
+  uint32_t allocs;     // per result (average)
+  double usPerResult;
+};
+
+template <typename F>
+static Run measure(const char *name, F render)
+{
+  Run r = {name, 0, 0, 0};
+  size_t bytes = 0;
+  counting = true;
+  allocations = 0;
+  for (const Sample &s : samples)
+    bytes += render(s);
+  counting = false;
+  r.bytes = bytes / RESULTS;
+  r.allocs = allocations / RESULTS;
+
+  uint32_t best = UINT32_MAX;
+  for (int k = 0; k < ROUNDS; k++)
+  {
+    uint32_t t0 = micros();
+    for (const Sample &s : samples)
+      bytes += render(s);
+    uint32_t us = micros() - t0;
+    if (us < best)
+      best = us;
+  }
+  r.usPerResult = (double)best / RESULTS;
+  TEST_ASSERT_TRUE(bytes > 0);
+  return r;
+}
+
+static char out[8192];
+
+static void report(const Run &r)
+{
+  char msg[128];
+  snprintf(msg, sizeof(msg), "%-26s %5u B  %4u allocations  %6.2f us per result", r.name,
+           (unsigned)r.bytes, (unsigned)r.allocs, r.usPerResult);
+  TEST_MESSAGE(msg);
+}
+
+// The pretty writer output is what the old generator produced
+static void test_same_document_as_string_chain()
+{
+  randomSamples();
+  for (const Sample &s : samples)
+  {
+    String old = legacy::generateResultJSON(s.packets, s.imp20k, s.imp100k);
+    JsonWriter w(out, sizeof(out));
+    writeResultJSON(w, s.result);
+    w.finish();
+    TEST_ASSERT_FALSE(w.overflowed());
+    TEST_ASSERT_EQUAL_STRING(old.c_str(), out);
+  }
+}
+
+static void test_bytes_allocations_and_time()
+{
+  randomSamples();
+  Run runs[] = {
+      measure("old String chain", [](const Sample &s) {
+        return legacy::generateResultJSON(s.packets, s.imp20k, s.imp100k).length();
+      }),
+      measure("JsonWriter pretty, buffer", [](const Sample &s) {
+        JsonWriter w(out, sizeof(out));
+        writeResultJSON(w, s.result);
+        return w.finish();
+      }),
+      measure("JsonWriter compact, buffer", [](const Sample &s) {
+        JsonWriter w(out, sizeof(out), true);
+        writeResultJSON(w, s.result);
+        return w.finish();
+      }),
+      measure("JsonWriter compact, sink", [](const Sample &s) {
+        char chunk[NOTIFY_PAYLOAD]; // as BleResultSink streams it
+        JsonWriter w(chunk, sizeof(chunk), discard, nullptr, true);
+        writeResultJSON(w, s.result);
+        return w.finish();
+      }),
+  };
+
+  for (const Run &r : runs)
+    report(r);
+
+  TEST_ASSERT_GREATER_THAN(100, runs[0].allocs);
+  for (size_t i = 1; i < sizeof(runs) / sizeof(runs[0]); i++)
+    TEST_ASSERT_EQUAL_UINT32(0, runs[i].allocs);
+  TEST_ASSERT_EQUAL_size_t(runs[2].bytes, runs[3].bytes);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_same_document_as_string_chain);
+  RUN_TEST(test_bytes_allocations_and_time);
+  return UNITY_END();
+}
@@ -0,0 +1,256 @@
+// เบนช์มาร์ก RX: ring แบบเดิม (modulo + copy) เทียบ RxRing + FrameView
+#include <unity.h>
+#include "buffer.h"
+
+// Sustained A1/B1 answer stream, as during SEND_A1_LOOP / SEND_B1_LOOP
+static const size_t STREAM_BYTES = 4u << 20;
+// Bytes the UART hands over per pass (one RX FIFO threshold)
+static const size_t CHUNK_BYTES = 120;
+static const int ROUNDS = 5;
+
+void setUp() {}
+void tearDown() {}
+
+// ---- the RX path before the RxRing rewrite (buffer.cpp, main.cpp) ----
+namespace legacy
+{
+static uint8_t rxBuf[RX_BUF_SIZE];
+static size_t rxHead = 0;
+static size_t rxTail = 0;
+
+static uint8_t computeChecksum(const uint8_t *buf, size_t lenWithoutChecksum)
+{
+  uint32_t s = 0;
+  for (size_t i = 0; i < lenWithoutChecksum; ++i)
+    s += buf[i];
+  uint8_t sum8 = (uint8_t)(s & 0xFF);
+  return (uint8_t)((~sum8 + 1) & 0xFF);
+}
+
+static void pushRxByte(uint8_t b)
+{
+  rxBuf[rxHead] = b;
+  rxHead = (rxHead + 1) % RX_BUF_SIZE;
+  if (rxHead == rxTail)
+    rxTail = (rxTail + 1) % RX_BUF_SIZE;
+}
+
+static size_t rxAvailable()
+{
+  if (rxHead >= rxTail)
+    return rxHead - rxTail;
+  return RX_BUF_SIZE - (rxTail - rxHead);
+}
+
+static bool rxPeek(size_t i, uint8_t &out)
+{
+  if (i >= rxAvailable())
+    return false;
+  out = rxBuf[(rxTail + i) % RX_BUF_SIZE];
+  return true;
+}
+
+static bool rxRead(uint8_t &out)
+{
+  if (rxAvailable() == 0)
+    return false;
+  out = rxBuf[rxTail];
+  rxTail = (rxTail + 1) % RX_BUF_SIZE;
+  return true;
+}
+
+static bool tryParseFrame(uint8_t *frameBuf, size_t &frameLen)
+{
+  if (rxAvailable() < 3)
+    return false;
+
+  bool found = false;
+  size_t avail = rxAvailable();
+  for (size_t i = 0; i < avail; ++i)
+  {
+    uint8_t b;
+    rxPeek(i, b);
+    if (b == 0xAA)
+    {
+      for (size_t j = 0; j < i; ++j)
+      {
+        uint8_t tmp;
+        rxRead(tmp);
+      }
+      found = true;
+      break;
+    }
+  }
+  if (!found)
+  {
+    uint8_t tmp;
+    while (rxRead(tmp))
+      ;
+    return false;
+  }
+
+  if (rxAvailable() < 2)
+    return false;
+  uint8_t hdr, lengthByte;
+  rxPeek(0, hdr);
+  rxPeek(1, lengthByte);
+
+  size_t totalFrameLen = (size_t)lengthByte;
+  if (totalFrameLen < 5)
+  {
+    uint8_t tmp;
+    rxRead(tmp);
+    return false;
+  }
+  if (rxAvailable() < totalFrameLen)
+    return false;
+
+  for (size_t i = 0; i < totalFrameLen; ++i)
+    rxRead(frameBuf[i]);
+  frameLen = totalFrameLen;
+
+  uint8_t checksum = frameBuf[frameLen - 1];
+  return checksum == computeChecksum(frameBuf, frameLen - 1);
+}
+} // namespace legacy
+
+// UART stand-in: hands out CHUNK_BYTES of the stream per pass
+class StreamPort : public Stream
+{
+public:
+  StreamPort(const uint8_t *data, size_t len) : data(data), len(len) {}
+
+  void nextChunk() { limit = (pos + CHUNK_BYTES < len) ? pos + CHUNK_BYTES : len; }
+  bool done() const { return pos == len; }
+
+  int available() override { return (int)(limit - pos); }
+  int read() override { return (pos < limit) ? data[pos++] : -1; }
+  size_t readBytes(uint8_t *buf, size_t n) override
+  {
+    n = (n < limit - pos) ? n : limit - pos;
+    memcpy(buf, data + pos, n);
+    pos += n;
+    return n;
+  }
+
+private:
+  const uint8_t *data;
+  size_t len;
+  size_t pos = 0;
+  size_t limit = 0;
+};
+
+static uint8_t stream[STREAM_BYTES];
+static size_t streamLen = 0;
+static uint32_t streamFrames = 0;
+
+static void buildStream()
+{
+  // A1 (14 bytes) and B1 (26 bytes) answers, three A1 per B1
+  uint32_t n = 0;
+  while (true)
+  {
+    uint8_t len = (n % 4 == 3) ? 26 : 14;
+    if (streamLen + len > STREAM_BYTES)
+      break;
+    uint8_t *f = &stream[streamLen];
+    f[0] = 0xAA;
+    f[1] = len;
+    f[2] = (len == 26) ? 0xB1 : 0xA1;
+    for (uint8_t i = 3; i < len - 1; i++)
+      f[i] = (uint8_t)(n * 31 + i);
+    f[len - 1] = legacy::computeChecksum(f, len - 1);
+    streamLen += len;
+    n++;
+  }
+  streamFrames = n;
+}
+
+// What processDeviceFrame reads from each answer
+struct Consumed
+{
+  uint32_t frames = 0;
+  uint32_t sum = 0;
+};
+
+static Consumed runLegacy(uint32_t &us)
+{
+  StreamPort port(stream, streamLen);
+  Consumed c;
+  uint32_t t0 = micros();
+  while (!port.done())
+  {
+    port.nextChunk();
+    while (port.available())
+      legacy::pushRxByte((uint8_t)port.read());
+
+    uint8_t frameBuf[256];
+    size_t frameLen = 0;
+    while (legacy::tryParseFrame(frameBuf, frameLen))
+    {
+      c.frames++;
+      c.sum += (frameBuf[2] == 0xA1) ? (uint32_t)frameBuf[9] | ((uint32_t)frameBuf[10] << 8)
+                                     : (uint32_t)frameBuf[6] | ((uint32_t)frameBuf[7] << 8);
+    }
+  }
+  us = micros() - t0;
+  return c;
+}
+
+static Consumed runRing(uint32_t &us)
+{
+  StreamPort port(stream, streamLen);
+  Consumed c;
+  uint32_t t0 = micros();
+  while (!port.done())
+  {
+    port.nextChunk();
+    pushRxBytes(port, port.available());
+
+    FrameView frame;
+    while (tryParseFrame(frame))
+    {
+      c.frames++;
+      c.sum += (frame[2] == 0xA1) ? frame.u16(9) : frame.u16(6);
+      releaseFrame(frame);
+    }
+  }
+  us = micros() - t0;
+  return c;
+}
+
+static void test_rx_throughput()
+{
+  buildStream();
+  uint32_t bestLegacy = UINT32_MAX, bestRing = UINT32_MAX;
+  Consumed a, b;
+  for (int r = 0; r < ROUNDS; r++)
+  {
+    uint32_t us;
+    a = runLegacy(us);
+    if (us < bestLegacy)
+      bestLegacy = us;
+    b = runRing(us);
+    if (us < bestRing)
+      bestRing = us;
+  }
+
+  // same frames, same values, on both paths
+  TEST_ASSERT_EQUAL_UINT32(streamFrames, a.frames);
+  TEST_ASSERT_EQUAL_UINT32(streamFrames, b.frames);
+  TEST_ASSERT_EQUAL_UINT32(a.sum, b.sum);
+
+  char msg[160];
+  snprintf(msg, sizeof(msg), "%lu bytes, %lu frames, best of %d: legacy %.1f bytes/us, RxRing %.1f bytes/us (x%.2f)",
+           (unsigned long)streamLen, (unsigned long)streamFrames, ROUNDS,
+           (double)streamLen / (bestLegacy ? bestLegacy : 1), (double)streamLen / (bestRing ? bestRing : 1),
+           (double)bestLegacy / (bestRing ? bestRing : 1));
+  TEST_MESSAGE(msg);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_rx_throughput);
+  return UNITY_END();
+}
@@ -0,0 +1,150 @@
+// คิว RX แบบ SPSC: producer/consumer คนละ thread พร้อมกัน
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include "buffer.h"
+
+static const uint32_t FRAME_COUNT = 200000;
+static const uint32_t TIMEOUT_MS = 20000;
+
+void setUp() {}
+void tearDown() {}
+
+// Frame n: A1 (14 bytes) or B1 (26 bytes), payload = n then n+i, so the
+// consumer can check order and content without sharing state
+static size_t buildFrame(uint32_t n, uint8_t *out)
+{
+  uint8_t len = (n % 3 == 2) ? 26 : 14;
+  out[0] = 0xAA;
+  out[1] = len;
+  out[2] = (len == 26) ? 0xB1 : 0xA1;
+  memcpy(&out[3], &n, 4);
+  for (uint8_t i = 7; i < len - 1; i++)
+    out[i] = (uint8_t)(n + i);
+  uint8_t sum = 0;
+  for (uint8_t i = 0; i < len - 1; i++)
+    sum += out[i];
+  out[len - 1] = (uint8_t)(0 - sum);
+  return len;
+}
+
+// Bytes before some frames, never 0xAA, skipped by the decoder
+static size_t gapBytes(uint32_t n)
+{
+  return (n % 7 == 0) ? (n % 5) + 1 : 0;
+}
+
+// Gap bytes + frame n, byte by byte
+struct StreamGen
+{
+  uint32_t n = 0;
+  uint8_t item[40];
+  size_t len = 0, pos = 0;
+
+  bool next(uint8_t &b)
+  {
+    if (pos == len)
+    {
+      if (n == FRAME_COUNT)
+        return false;
+      size_t gap = gapBytes(n);
+      memset(item, 0x55, gap);
+      len = gap + buildFrame(n++, item + gap);
+      pos = 0;
+    }
+    b = item[pos++];
+    return true;
+  }
+};
+
+static std::atomic<bool> producerFailed{false};
+
+static void producer(const std::atomic<bool> &stop)
+{
+  // the frame stream cut into chunks of 1..61 bytes, as the UART
+  // callback sees them
+  StreamGen gen;
+  uint8_t chunk[64];
+  uint32_t k = 0;
+  bool more = true;
+
+  while (more && !stop.load())
+  {
+    size_t want = 1 + (k++ * 7) % 61;
+    size_t fill = 0;
+    while (fill < want && (more = gen.next(chunk[fill])))
+      fill++;
+
+    // the UART driver holds what the ring cannot take yet
+    while (RxRing::CAPACITY - rxAvailable() < fill && !stop.load())
+      std::this_thread::yield();
+    if (pushRxBytes(chunk, fill) != fill)
+      producerFailed.store(true);
+  }
+}
+
+static void test_frames_arrive_whole_and_in_order()
+{
+  std::atomic<bool> stop{false};
+  std::thread prod(producer, std::cref(stop));
+
+  uint32_t expected = 0;
+  uint32_t wrapped = 0;
+  uint32_t start = millis();
+  const char *failure = nullptr;
+  uint8_t want[32], got[32];
+
+  while (expected < FRAME_COUNT && !failure)
+  {
+    FrameView frame;
+    if (!tryParseFrame(frame))
+    {
+      if (millis() - start > TIMEOUT_MS)
+        failure = "timed out waiting for frames";
+      std::this_thread::yield();
+      continue;
+    }
+
+    size_t len = buildFrame(expected, want);
+    if (frame.len2 > 0)
+      wrapped++;
+    if (frame.size() != len)
+      failure = "frame length";
+    else if (frame.u32(3) != expected)
+      failure = "frame out of order";
+    else
+    {
+      frame.copyTo(got);
+      if (memcmp(want, got, len) != 0)
+        failure = "frame content";
+    }
+    releaseFrame(frame);
+    expected++;
+  }
+
+  stop.store(true);
+  prod.join();
+  if (failure)
+    TEST_FAIL_MESSAGE(failure);
+  TEST_ASSERT_FALSE(producerFailed.load());
+
+  uint32_t gaps = 0;
+  for (uint32_t n = 0; n < FRAME_COUNT; n++)
+    gaps += gapBytes(n);
+
+  const FrameStats &st = frameStats();
+  TEST_ASSERT_EQUAL_UINT32(FRAME_COUNT, st.framesOk);
+  TEST_ASSERT_EQUAL_UINT32(0, st.framesLost());
+  TEST_ASSERT_EQUAL_UINT32(gaps, st.bytesDropped);
+  TEST_ASSERT_EQUAL_UINT32(0, rxOverflowStats().events);
+  // the ring wrapped under frames many times, not just once
+  TEST_ASSERT_GREATER_THAN(1000, wrapped);
+  TEST_ASSERT_EQUAL_size_t(0, rxAvailable());
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_frames_arrive_whole_and_in_order);
+  return UNITY_END();
+}
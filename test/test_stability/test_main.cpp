@@ -0,0 +1,148 @@
+// ตัวตรวจจับน้ำหนักนิ่ง: จำลองการขึ้นชั่งแบบหน่วง + noise เทียบทั้งสามแบบ
+#include <unity.h>
+#include <random>
+#include "stability.h"
+
+// One A1 answer every 200 ms, as in SEND_A1_LOOP
+static const uint32_t SAMPLE_MS = 200;
+static const uint32_t SESSION_MS = 20000;
+static const int SESSIONS = 200;
+static const double NOISE_G = 50.0;
+
+void setUp() {}
+void tearDown() {}
+
+// Step-on curve: settles exponentially from W + A towards W (grams)
+struct StepOn
+{
+  double w, a, tauMs;
+
+  double at(uint32_t ms) const { return w + a * exp(-(double)ms / tauMs); }
+};
+
+static StepOn randomStepOn(std::mt19937 &rng)
+{
+  StepOn s;
+  s.w = 60000 + rng() % 40000;
+  s.a = (rng() % 2 ? 1.0 : -1.0) * (double)(3000 + rng() % 15000);
+  s.tauMs = 500 + rng() % 1500;
+  return s;
+}
+
+struct DetectorResult
+{
+  int locked = 0;
+  double lockMsSum = 0;
+  double errSum = 0; // |locked - W|, g
+  bool progressOk = true;
+
+  double avgLockMs() const { return locked ? lockMsSum / locked : 0; }
+  double avgErrKg() const { return locked ? errSum / locked / 1000.0 : 0; }
+};
+
+static ConsecutiveStability consecutive;
+static WindowStability window;
+static PredictiveStability predictive;
+static StabilityDetector *const DETECTORS[STABILITY_MODE_COUNT] = {&consecutive, &window, &predictive};
+
+static void simulate(DetectorResult (&res)[STABILITY_MODE_COUNT])
+{
+  std::mt19937 rng(1);
+  std::normal_distribution<double> noise(0, NOISE_G);
+
+  for (int s = 0; s < SESSIONS; s++)
+  {
+    StepOn curve = randomStepOn(rng);
+    bool done[STABILITY_MODE_COUNT] = {};
+    for (StabilityDetector *d : DETECTORS)
+      d->reset();
+
+    for (uint32_t ms = SAMPLE_MS; ms <= SESSION_MS; ms += SAMPLE_MS)
+    {
+      long v = lround(curve.at(ms) + noise(rng));
+      for (uint8_t m = 0; m < STABILITY_MODE_COUNT; m++)
+      {
+        if (done[m])
+          continue;
+        bool stable = DETECTORS[m]->addSample(v);
+        int p = DETECTORS[m]->progress();
+        // stable_count: 0..STABLE_REQUIRED_CNT, the top only at lock
+        if (p < 0 || p > STABLE_REQUIRED_CNT || (p == STABLE_REQUIRED_CNT) != stable)
+          res[m].progressOk = false;
+        if (stable)
+        {
+          done[m] = true;
+          res[m].locked++;
+          res[m].lockMsSum += ms;
+          res[m].errSum += fabs(DETECTORS[m]->value() - curve.w);
+        }
+      }
+    }
+  }
+}
+
+static void test_detectors_on_step_on_curves()
+{
+  DetectorResult res[STABILITY_MODE_COUNT];
+  simulate(res);
+
+  char msg[120];
+  for (uint8_t m = 0; m < STABILITY_MODE_COUNT; m++)
+  {
+    snprintf(msg, sizeof(msg), "%-12s locked %3d/%d, avg %5.0f ms to lock, mean |error| %.3f kg",
+             DETECTORS[m]->name(), res[m].locked, SESSIONS, res[m].avgLockMs(), res[m].avgErrKg());
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE_MESSAGE(res[m].progressOk, DETECTORS[m]->name());
+  }
+
+  const DetectorResult &c = res[STABILITY_CONSECUTIVE];
+  const DetectorResult &w = res[STABILITY_WINDOW];
+  const DetectorResult &p = res[STABILITY_PREDICTIVE];
+
+  // every curve settles within the session
+  TEST_ASSERT_EQUAL_INT32(SESSIONS, c.locked);
+  TEST_ASSERT_EQUAL_INT32(SESSIONS, w.locked);
+  TEST_ASSERT_GREATER_THAN(SESSIONS * 9 / 10, p.locked);
+  // each rule locks sooner than the one before it...
+  TEST_ASSERT_TRUE(w.avgLockMs() < c.avgLockMs());
+  TEST_ASSERT_TRUE(p.avgLockMs() < w.avgLockMs());
+  // ...and stays within the window tolerance. The window locks on the mean
+  // while the tail is still decaying, so it trades accuracy for time
+  // against the legacy counter; this is not asserted either way.
+  for (const DetectorResult &r : res)
+    TEST_ASSERT_TRUE(r.avgErrKg() * 1000.0 < STABILITY_TOLERANCE);
+}
+
+static void test_slower_detectors_keep_running_after_lock()
+{
+  // flat readings lock the active detector long before the consecutive
+  // counter reaches STABLE_REQUIRED_CNT
+  weightStabilityBegin();
+  long locked = 0;
+  int samples = 0;
+  while (!weightStabilityAdd(70000, locked))
+    TEST_ASSERT_TRUE(++samples < STABLE_REQUIRED_CNT);
+  TEST_ASSERT_EQUAL_INT32(70000, locked);
+  TEST_ASSERT_EQUAL_INT32(0, stabilityReport().lockMs[STABILITY_CONSECUTIVE]);
+
+  // user still on the scale after the measurement (WAIT_SCALE_EMPTY)
+  for (int i = 0; i < STABLE_REQUIRED_CNT; i++)
+    weightStabilityReference(70000);
+
+  const StabilityReport &r = stabilityReport();
+  TEST_ASSERT_TRUE(r.lockMs[STABILITY_CONSECUTIVE] != 0);
+  TEST_ASSERT_EQUAL_INT32(70000, r.lockValue[STABILITY_CONSECUTIVE]);
+  TEST_ASSERT_TRUE(r.afterMeasurement[STABILITY_CONSECUTIVE]);
+  TEST_ASSERT_FALSE(r.afterMeasurement[WEIGHT_STABILITY_MODE]);
+  // the locked weight is not changed by the later samples
+  TEST_ASSERT_FALSE(weightStabilityAdd(71000, locked));
+  TEST_ASSERT_EQUAL_INT32(70000, r.lockValue[WEIGHT_STABILITY_MODE]);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_detectors_on_step_on_curves);
+  RUN_TEST(test_slower_detectors_keep_running_after_lock);
+  return UNITY_END();
+}